@@ -0,0 +1,45 @@
+#version 460 core
+
+const vec3 LUMA = vec3(0.299, 0.587, 0.114);
+const float SPAN_MAX = 8.0;
+const float REDUCE_MUL = 1.0 / 8.0;
+const float REDUCE_MIN = 1.0 / 128.0;
+
+layout (binding = 0) uniform sampler2D frame;
+layout (location = 0) uniform vec2 texelSize;
+
+in vec2 frameCoord;
+out vec4 FragColor;
+
+// FXAA after Lottes: estimate the edge direction from the luma of the four
+// diagonal neighbours and blend along it, falling back to the narrower blend
+// when the wider one overshoots the local luma range.
+void main()
+{
+    vec3 colorM = texture(frame, frameCoord).rgb;
+    float lumaM = dot(colorM, LUMA);
+    float lumaNW = dot(texture(frame, frameCoord + vec2(-1.0, -1.0) * texelSize).rgb, LUMA);
+    float lumaNE = dot(texture(frame, frameCoord + vec2(1.0, -1.0) * texelSize).rgb, LUMA);
+    float lumaSW = dot(texture(frame, frameCoord + vec2(-1.0, 1.0) * texelSize).rgb, LUMA);
+    float lumaSE = dot(texture(frame, frameCoord + vec2(1.0, 1.0) * texelSize).rgb, LUMA);
+
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+    vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)),
+                          (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL,
+                       REDUCE_MIN);
+    float scale = 1.0 / (min(abs(direction.x), abs(direction.y)) + reduce);
+    direction = clamp(direction * scale, vec2(-SPAN_MAX), vec2(SPAN_MAX)) *
+                texelSize;
+
+    vec3 colorA = 0.5 * (texture(frame, frameCoord + direction * (1.0 / 3.0 - 0.5)).rgb +
+                         texture(frame, frameCoord + direction * (2.0 / 3.0 - 0.5)).rgb);
+    vec3 colorB = colorA * 0.5 +
+                  0.25 * (texture(frame, frameCoord - direction * 0.5).rgb +
+                          texture(frame, frameCoord + direction * 0.5).rgb);
+    float lumaB = dot(colorB, LUMA);
+
+    FragColor = vec4((lumaB < lumaMin || lumaB > lumaMax) ? colorA : colorB, 1.0);
+}
@@ -0,0 +1,42 @@
+#version 460 core
+
+const uint CAP_BUTT = 0u;
+const uint CAP_ROUND = 1u;
+
+in vec2 linePosition;
+in vec4 lineColor;
+flat in float segmentLength;
+flat in float halfWidth;
+flat in uint startCap;
+flat in uint endCap;
+out vec4 FragColor;
+
+// Signed pixel distance to a cap past the segment end, overshoot pixels
+// beyond it.
+float capDistance(uint cap, float overshoot, float across)
+{
+    if (cap == CAP_ROUND) {
+        return length(vec2(overshoot, across)) - halfWidth;
+    }
+    float capLength = cap == CAP_BUTT ? 0.0 : halfWidth;
+    return max(abs(across) - halfWidth, overshoot - capLength);
+}
+
+void main()
+{
+    // Positions are already in pixels, so the distance needs no derivatives.
+    float along = linePosition.x;
+    float across = linePosition.y;
+    float distance = abs(across) - halfWidth;
+    if (along < 0.0) {
+        distance = capDistance(startCap, -along, across);
+    } else if (along > segmentLength) {
+        distance = capDistance(endCap, along - segmentLength, across);
+    }
+
+    float coverage = clamp(0.5 - distance, 0.0, 1.0);
+    if (coverage <= 0.0) {
+        discard;
+    }
+    FragColor = vec4(lineColor.rgb, lineColor.a * coverage);
+}
@@ -0,0 +1,33 @@
+#version 460 core
+
+const float PI = 3.14159265359;
+const float TWO_PI = 6.28318530718;
+const uint COLOR_ANGLE = 1u;
+
+in vec2 ellipseCoord;
+flat in uint colorRule;
+flat in vec3 fillColor;
+out vec4 FragColor;
+
+void main()
+{
+    // Implicit ellipse in unit-circle space; dividing by its screen-space
+    // derivative turns it into an approximate distance in pixels.
+    float f = length(ellipseCoord) - 1.0;
+    float coverage = clamp(0.5 - f / fwidth(f), 0.0, 1.0);
+    if (coverage <= 0.0) {
+        discard;
+    }
+
+    vec3 color = fillColor;
+    if (colorRule == COLOR_ANGLE) {
+        // Same angle convention as generateEllipsePoints: (sin, cos),
+        // starting at pi / 2.
+        float angle = atan(ellipseCoord.x, ellipseCoord.y);
+        if (angle < PI / 2.0) {
+            angle += TWO_PI;
+        }
+        color = vec3(angle / TWO_PI, 0.0, 0.0) * fillColor;
+    }
+    FragColor = vec4(color, coverage);
+}
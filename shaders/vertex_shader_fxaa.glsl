@@ -0,0 +1,11 @@
+#version 460 core
+
+out vec2 frameCoord;
+
+void main()
+{
+    // One triangle covering the screen: (0, 0), (2, 0), (0, 2) in uv.
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    frameCoord = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
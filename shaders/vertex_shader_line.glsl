@@ -0,0 +1,78 @@
+#version 460 core
+
+struct Shape
+{
+    mat4 transform;
+    vec4 color;
+};
+
+struct Segment
+{
+    vec2 from;
+    vec2 to;
+    vec4 fromColor;
+    vec4 toColor;
+    float width;
+    uint shapeIndex;
+    uint startCap;
+    uint endCap;
+};
+
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 viewProjection;
+};
+
+layout (std430, binding = 0) readonly buffer ShapeBuffer
+{
+    Shape shapes[];
+};
+
+layout (std430, binding = 2) readonly buffer SegmentBuffer
+{
+    Segment segments[];
+};
+
+layout (location = 0) uniform vec2 viewportSize;
+
+out vec2 linePosition;
+out vec4 lineColor;
+flat out float segmentLength;
+flat out float halfWidth;
+flat out uint startCap;
+flat out uint endCap;
+
+vec2 toPixels(vec4 clip)
+{
+    return (clip.xy / clip.w * 0.5 + 0.5) * viewportSize;
+}
+
+void main()
+{
+    Segment segment = segments[gl_InstanceID];
+    Shape shape = shapes[segment.shapeIndex];
+    mat4 transform = viewProjection * shape.transform;
+
+    vec2 from = toPixels(transform * vec4(segment.from, 0.0, 1.0));
+    vec2 to = toPixels(transform * vec4(segment.to, 0.0, 1.0));
+    segmentLength = length(to - from);
+    vec2 direction = segmentLength > 0.0 ? (to - from) / segmentLength
+                                         : vec2(1.0, 0.0);
+    vec2 normal = vec2(-direction.y, direction.x);
+
+    // Triangle strip corners along and across the segment, padded by the
+    // half width for caps and by a pixel for the anti-aliased fringe.
+    halfWidth = segment.width * 0.5;
+    float extent = halfWidth + 1.0;
+    float along = (gl_VertexID & 1) == 0 ? -extent : segmentLength + extent;
+    float across = (gl_VertexID >> 1) == 0 ? -extent : extent;
+    vec2 position = from + direction * along + normal * across;
+    gl_Position = vec4(position / viewportSize * 2.0 - 1.0, 0.0, 1.0);
+
+    linePosition = vec2(along, across);
+    float t = segmentLength > 0.0 ? clamp(along / segmentLength, 0.0, 1.0)
+                                  : 0.0;
+    lineColor = mix(segment.fromColor, segment.toColor, t) * shape.color;
+    startCap = segment.startCap;
+    endCap = segment.endCap;
+}
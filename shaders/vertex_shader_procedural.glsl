@@ -0,0 +1,63 @@
+#version 460 core
+
+const float TWO_PI = 6.28318530718;
+const uint COLOR_SOLID = 0u;
+const uint COLOR_ANGLE = 1u;
+const uint COLOR_CORNERS = 2u;
+
+struct Shape
+{
+    mat4 transform;
+    vec4 color;
+};
+
+struct Polygon
+{
+    vec2 center;
+    vec2 radius;
+    float startAngle;
+    uint segments;
+    uint colorRule;
+    uint shapeIndex;
+    vec4 color;
+};
+
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 viewProjection;
+};
+
+layout (std430, binding = 0) readonly buffer ShapeBuffer
+{
+    Shape shapes[];
+};
+
+layout (std430, binding = 1) readonly buffer PolygonBuffer
+{
+    Polygon polygons[];
+};
+
+out vec3 ourColor;
+
+void main()
+{
+    Polygon polygon = polygons[gl_BaseInstance + gl_InstanceID];
+    Shape shape = shapes[polygon.shapeIndex];
+
+    // Vertices arrive as an unrolled triangle fan: (0, k + 1, k + 2).
+    uint triangle = uint(gl_VertexID) / 3u;
+    uint corner = uint(gl_VertexID) % 3u;
+    uint point = corner == 0u ? 0u : triangle + corner;
+
+    float angle = polygon.startAngle + TWO_PI * float(point) / float(polygon.segments);
+    vec2 position = polygon.center + vec2(sin(angle), cos(angle)) * polygon.radius;
+    gl_Position = viewProjection * shape.transform * vec4(position, 0.0, 1.0);
+
+    vec3 color = polygon.color.rgb;
+    if (polygon.colorRule == COLOR_ANGLE) {
+        color = vec3(angle / TWO_PI, 0.0, 0.0);
+    } else if (polygon.colorRule == COLOR_CORNERS) {
+        color = vec3(point == 0u, point == 1u, point == 2u);
+    }
+    ourColor = color * shape.color.rgb;
+}
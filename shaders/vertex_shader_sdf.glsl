@@ -0,0 +1,56 @@
+#version 460 core
+
+struct Shape
+{
+    mat4 transform;
+    vec4 color;
+};
+
+struct Polygon
+{
+    vec2 center;
+    vec2 radius;
+    float startAngle;
+    uint segments;
+    uint colorRule;
+    uint shapeIndex;
+    vec4 color;
+};
+
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 viewProjection;
+};
+
+layout (std430, binding = 0) readonly buffer ShapeBuffer
+{
+    Shape shapes[];
+};
+
+layout (std430, binding = 1) readonly buffer PolygonBuffer
+{
+    Polygon polygons[];
+};
+
+layout (location = 0) uniform vec2 pixelSize;
+
+out vec2 ellipseCoord;
+flat out uint colorRule;
+flat out vec3 fillColor;
+
+void main()
+{
+    Polygon polygon = polygons[gl_InstanceID];
+    Shape shape = shapes[polygon.shapeIndex];
+
+    // Triangle strip corners (-1, -1), (1, -1), (-1, 1), (1, 1), padded by a
+    // pixel so the anti-aliased edge is not clipped.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vec2 extent = polygon.radius + pixelSize;
+    vec2 position = polygon.center + corner * extent;
+    gl_Position = viewProjection * shape.transform * vec4(position, 0.0, 1.0);
+
+    ellipseCoord = corner * extent / polygon.radius;
+    colorRule = polygon.colorRule;
+    fillColor = polygon.color.rgb * shape.color.rgb;
+}
@@ -2,10 +2,27 @@
 layout (location = 0) in vec2 vPosition;
 layout (location = 1) in vec3 vColor;
 
+struct Shape
+{
+    mat4 transform;
+    vec4 color;
+};
+
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 viewProjection;
+};
+
+layout (std430, binding = 0) readonly buffer ShapeBuffer
+{
+    Shape shapes[];
+};
+
 out vec3 ourColor;
 
 void main()
 {
-    gl_Position = vec4(vPosition, 0.0, 1.0);
-    ourColor = vColor;
+    Shape shape = shapes[gl_BaseInstance + gl_InstanceID];
+    gl_Position = viewProjection * shape.transform * vec4(vPosition, 0.0, 1.0);
+    ourColor = vColor * shape.color.rgb;
 }
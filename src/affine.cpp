@@ -0,0 +1,347 @@
+#include "affine.h"
+
+#include "parallel.h"
+#include "simd.h"
+
+const size_t AFFINE_MIN_PER_THREAD = 1 << 15;
+
+Affine3 toAffine3(const glm::mat4 &m) {
+  Affine3 a;
+  for (int i = 0; i < 3; ++i) {
+    a.rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+  }
+  return a;
+}
+
+glm::mat4 toMat4(const Affine3 &a) {
+  glm::mat4 m(1.0f);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      m[j][i] = a.rows[i][j];
+    }
+  }
+  return m;
+}
+
+glm::vec3 transformPoint(const Affine3 &a, const glm::vec3 &p) {
+  glm::vec4 h(p, 1.0f);
+  return glm::vec3(glm::dot(a.rows[0], h), glm::dot(a.rows[1], h),
+                   glm::dot(a.rows[2], h));
+}
+
+glm::vec3 transformVector(const Affine3 &a, const glm::vec3 &v) {
+  glm::vec4 h(v, 0.0f);
+  return glm::vec3(glm::dot(a.rows[0], h), glm::dot(a.rows[1], h),
+                   glm::dot(a.rows[2], h));
+}
+
+#ifdef SIMD_X86
+// SSE2 is always present on x86-64, so the single-transform kernels need no
+// dispatch. An Affine2 loads as the 2x2 part [x.x x.y y.x y.y] plus the
+// translation in the low half of a second register.
+
+Affine2 inverseAffine(const Affine2 &a) {
+  __m128 m = _mm_loadu_ps(&a.x.x);
+  __m128 t = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)&a.t.x);
+  __m128 product =
+      _mm_mul_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(0, 1, 2, 3)));
+  __m128 det = _mm_sub_ps(_mm_shuffle_ps(product, product, 0x00),
+                          _mm_shuffle_ps(product, product, 0x55));
+  __m128 adjugate = _mm_xor_ps(_mm_shuffle_ps(m, m, _MM_SHUFFLE(0, 2, 1, 3)),
+                               _mm_setr_ps(0.0f, -0.0f, -0.0f, 0.0f));
+  __m128 inverse = _mm_div_ps(adjugate, det);
+  __m128 tx = _mm_shuffle_ps(t, t, 0x00), ty = _mm_shuffle_ps(t, t, 0x55);
+  __m128 newT = _mm_add_ps(_mm_mul_ps(_mm_movelh_ps(inverse, inverse), tx),
+                           _mm_mul_ps(_mm_movehl_ps(inverse, inverse), ty));
+  newT = _mm_xor_ps(newT, _mm_set1_ps(-0.0f));
+
+  Affine2 result;
+  _mm_storeu_ps(&result.x.x, inverse);
+  _mm_storel_pi((__m64 *)&result.t.x, newT);
+  return result;
+}
+
+Affine2 composeAffineSse(const Affine2 &a, const Affine2 &b) {
+  __m128 ma = _mm_loadu_ps(&a.x.x), mb = _mm_loadu_ps(&b.x.x);
+  __m128 ta = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)&a.t.x);
+  __m128 tb = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)&b.t.x);
+  __m128 ax = _mm_movelh_ps(ma, ma), ay = _mm_movehl_ps(ma, ma);
+  __m128 m = _mm_add_ps(
+      _mm_mul_ps(ax, _mm_shuffle_ps(mb, mb, _MM_SHUFFLE(2, 2, 0, 0))),
+      _mm_mul_ps(ay, _mm_shuffle_ps(mb, mb, _MM_SHUFFLE(3, 3, 1, 1))));
+  __m128 t = _mm_add_ps(_mm_mul_ps(ax, _mm_shuffle_ps(tb, tb, 0x00)),
+                        _mm_mul_ps(ay, _mm_shuffle_ps(tb, tb, 0x55)));
+  t = _mm_add_ps(t, ta);
+
+  Affine2 result;
+  _mm_storeu_ps(&result.x.x, m);
+  _mm_storel_pi((__m64 *)&result.t.x, t);
+  return result;
+}
+
+Affine3 composeAffine(const Affine3 &a, const Affine3 &b) {
+  __m128 b0 = _mm_loadu_ps(&b.rows[0].x), b1 = _mm_loadu_ps(&b.rows[1].x);
+  __m128 b2 = _mm_loadu_ps(&b.rows[2].x);
+  __m128 lastLane = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+  Affine3 result;
+  for (int i = 0; i < 3; ++i) {
+    __m128 row = _mm_loadu_ps(&a.rows[i].x);
+    __m128 r = _mm_and_ps(row, lastLane);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, 0x00), b0));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, 0x55), b1));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, 0xAA), b2));
+    _mm_storeu_ps(&result.rows[i].x, r);
+  }
+  return result;
+}
+
+__m128 crossSse(__m128 a, __m128 b) {
+  __m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+  return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+Affine3 inverseAffine(const Affine3 &a) {
+  __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+  __m128 r0 = _mm_loadu_ps(&a.rows[0].x), r1 = _mm_loadu_ps(&a.rows[1].x);
+  __m128 r2 = _mm_loadu_ps(&a.rows[2].x);
+  __m128 t = _mm_unpackhi_ps(_mm_unpackhi_ps(r0, r2),
+                             _mm_unpackhi_ps(r1, r1));
+  r0 = _mm_and_ps(r0, xyz);
+  r1 = _mm_and_ps(r1, xyz);
+  r2 = _mm_and_ps(r2, xyz);
+
+  // The columns of the inverse are the cross products of the rows over the
+  // determinant.
+  __m128 c0 = crossSse(r1, r2), c1 = crossSse(r2, r0), c2 = crossSse(r0, r1);
+  __m128 det = _mm_mul_ps(r0, c0);
+  det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+  det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+  __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+  c0 = _mm_mul_ps(c0, invDet);
+  c1 = _mm_mul_ps(c1, invDet);
+  c2 = _mm_mul_ps(c2, invDet);
+  __m128 c3 = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(t, t, 0x00)),
+                 _mm_mul_ps(c1, _mm_shuffle_ps(t, t, 0x55))),
+      _mm_mul_ps(c2, _mm_shuffle_ps(t, t, 0xAA)));
+  c3 = _mm_xor_ps(c3, _mm_set1_ps(-0.0f));
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+  Affine3 result;
+  _mm_storeu_ps(&result.rows[0].x, c0);
+  _mm_storeu_ps(&result.rows[1].x, c1);
+  _mm_storeu_ps(&result.rows[2].x, c2);
+  return result;
+}
+
+// Four points per register: [x0 y0 x1 y1 ...] is split into broadcast x
+// and y pairs and multiplied by the matching basis columns.
+SIMD_AVX2 size_t transformPointsAvx2(const Affine2 &a, const glm::vec2 in[],
+                                     glm::vec2 out[], size_t count,
+                                     bool translate) {
+  __m256 ax = _mm256_setr_ps(a.x.x, a.x.y, a.x.x, a.x.y, a.x.x, a.x.y, a.x.x,
+                             a.x.y);
+  __m256 ay = _mm256_setr_ps(a.y.x, a.y.y, a.y.x, a.y.y, a.y.x, a.y.y, a.y.x,
+                             a.y.y);
+  __m256 t = translate ? _mm256_setr_ps(a.t.x, a.t.y, a.t.x, a.t.y, a.t.x,
+                                        a.t.y, a.t.x, a.t.y)
+                       : _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256 p = _mm256_loadu_ps(&in[i].x);
+    __m256 r = _mm256_fmadd_ps(ax, _mm256_moveldup_ps(p), t);
+    r = _mm256_fmadd_ps(ay, _mm256_movehdup_ps(p), r);
+    _mm256_storeu_ps(&out[i].x, r);
+  }
+  return i;
+}
+
+// Four points per iteration: the three registers holding them are
+// shuffled into x, y and z lanes, transformed, and shuffled back.
+size_t transformPointsSse(const Affine3 &a, const glm::vec3 in[],
+                          glm::vec3 out[], size_t count) {
+  __m128 m[3][4];
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      m[r][c] = _mm_set1_ps(a.rows[r][c]);
+    }
+  }
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float *p = &out[i].x;
+    const float *q = &in[i].x;
+    __m128 l0 = _mm_loadu_ps(q), l1 = _mm_loadu_ps(q + 4);
+    __m128 l2 = _mm_loadu_ps(q + 8);
+    __m128 xy23 = _mm_shuffle_ps(l1, l2, _MM_SHUFFLE(2, 1, 3, 2));
+    __m128 yz01 = _mm_shuffle_ps(l0, l1, _MM_SHUFFLE(1, 0, 2, 1));
+    __m128 v[3] = {_mm_shuffle_ps(l0, xy23, _MM_SHUFFLE(2, 0, 3, 0)),
+                   _mm_shuffle_ps(yz01, xy23, _MM_SHUFFLE(3, 1, 2, 0)),
+                   _mm_shuffle_ps(yz01, l2, _MM_SHUFFLE(3, 0, 3, 1))};
+    __m128 o[3];
+    for (int r = 0; r < 3; ++r) {
+      o[r] = _mm_add_ps(_mm_mul_ps(m[r][0], v[0]), m[r][3]);
+      o[r] = _mm_add_ps(o[r], _mm_mul_ps(m[r][1], v[1]));
+      o[r] = _mm_add_ps(o[r], _mm_mul_ps(m[r][2], v[2]));
+    }
+    __m128 xy01 = _mm_unpacklo_ps(o[0], o[1]);
+    xy23 = _mm_unpackhi_ps(o[0], o[1]);
+    __m128 zxy = _mm_shuffle_ps(o[2], xy01, _MM_SHUFFLE(3, 2, 1, 0));
+    __m128 zzxy = _mm_shuffle_ps(o[2], xy23, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm_storeu_ps(p, _mm_shuffle_ps(xy01, zxy, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(p + 4, _mm_shuffle_ps(zxy, xy23, _MM_SHUFFLE(1, 0, 1, 3)));
+    _mm_storeu_ps(p + 8, _mm_shuffle_ps(zzxy, zzxy, _MM_SHUFFLE(1, 3, 2, 0)));
+  }
+  return i;
+}
+
+// The columns of the homogeneous mat4 in both halves of a register, each
+// multiplied by one broadcast component of the two points.
+SIMD_AVX2 size_t transformPaddedAvx2(const Affine3 &a, const glm::vec4 in[],
+                                     glm::vec4 out[], size_t count) {
+  glm::mat4 m = toMat4(a);
+  __m256 c[4];
+  for (int j = 0; j < 4; ++j) {
+    c[j] = _mm256_broadcast_ps((const __m128 *)&m[j].x);
+  }
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m256 p = _mm256_loadu_ps(&in[i].x);
+    __m256 r = _mm256_mul_ps(c[3], _mm256_permute_ps(p, 0xff));
+    r = _mm256_fmadd_ps(c[0], _mm256_permute_ps(p, 0x00), r);
+    r = _mm256_fmadd_ps(c[1], _mm256_permute_ps(p, 0x55), r);
+    r = _mm256_fmadd_ps(c[2], _mm256_permute_ps(p, 0xaa), r);
+    _mm256_storeu_ps(&out[i].x, r);
+  }
+  return i;
+}
+#else
+Affine2 inverseAffine(const Affine2 &a) {
+  float invDet = 1.0f / (a.x.x * a.y.y - a.y.x * a.x.y);
+  Affine2 result;
+  result.x = glm::vec2(a.y.y, -a.x.y) * invDet;
+  result.y = glm::vec2(-a.y.x, a.x.x) * invDet;
+  result.t = -transformVector(result, a.t);
+  return result;
+}
+
+Affine2 composeAffineSse(const Affine2 &a, const Affine2 &b) {
+  return composeAffine(a, b);
+}
+
+Affine3 composeAffine(const Affine3 &a, const Affine3 &b) {
+  Affine3 result;
+  for (int i = 0; i < 3; ++i) {
+    const glm::vec4 &row = a.rows[i];
+    result.rows[i] = row.x * b.rows[0] + row.y * b.rows[1] +
+                     row.z * b.rows[2] + glm::vec4(0.0f, 0.0f, 0.0f, row.w);
+  }
+  return result;
+}
+
+Affine3 inverseAffine(const Affine3 &a) {
+  glm::vec3 r0(a.rows[0]), r1(a.rows[1]), r2(a.rows[2]);
+  glm::vec3 t(a.rows[0].w, a.rows[1].w, a.rows[2].w);
+  glm::vec3 c0 = glm::cross(r1, r2), c1 = glm::cross(r2, r0),
+            c2 = glm::cross(r0, r1);
+  float invDet = 1.0f / glm::dot(r0, c0);
+  glm::mat3 inverse(c0 * invDet, c1 * invDet, c2 * invDet);
+  glm::vec3 newT = -(inverse * t);
+  Affine3 result;
+  for (int i = 0; i < 3; ++i) {
+    result.rows[i] = glm::vec4(inverse[0][i], inverse[1][i], inverse[2][i],
+                               newT[i]);
+  }
+  return result;
+}
+#endif
+
+void composeAffines(const Affine2 a[], const Affine2 b[], Affine2 out[],
+                    size_t count) {
+  parallelFor(count, AFFINE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      out[i] = composeAffineSse(a[i], b[i]);
+    }
+  });
+}
+
+void inverseAffines(const Affine2 a[], Affine2 out[], size_t count) {
+  parallelFor(count, AFFINE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      out[i] = inverseAffine(a[i]);
+    }
+  });
+}
+
+void transformAffine2(const Affine2 &a, const glm::vec2 in[], glm::vec2 out[],
+                      size_t count, bool translate) {
+  parallelFor(count, AFFINE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      i += transformPointsAvx2(a, in + begin, out + begin, end - begin,
+                               translate);
+    }
+#endif
+    for (; i < end; ++i) {
+      out[i] = translate ? transformPoint(a, in[i]) : transformVector(a, in[i]);
+    }
+  });
+}
+
+void transformPoints(const Affine2 &a, const glm::vec2 points[],
+                     glm::vec2 out[], size_t count) {
+  transformAffine2(a, points, out, count, true);
+}
+
+void transformVectors(const Affine2 &a, const glm::vec2 vectors[],
+                      glm::vec2 out[], size_t count) {
+  transformAffine2(a, vectors, out, count, false);
+}
+
+void composeAffines(const Affine3 a[], const Affine3 b[], Affine3 out[],
+                    size_t count) {
+  parallelFor(count, AFFINE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      out[i] = composeAffine(a[i], b[i]);
+    }
+  });
+}
+
+void inverseAffines(const Affine3 a[], Affine3 out[], size_t count) {
+  parallelFor(count, AFFINE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      out[i] = inverseAffine(a[i]);
+    }
+  });
+}
+
+void transformPoints(const Affine3 &a, const glm::vec3 points[],
+                     glm::vec3 out[], size_t count) {
+  parallelFor(count, AFFINE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    i += transformPointsSse(a, points + begin, out + begin, end - begin);
+#endif
+    for (; i < end; ++i) {
+      out[i] = transformPoint(a, points[i]);
+    }
+  });
+}
+
+void transformPoints(const Affine3 &a, const glm::vec4 points[],
+                     glm::vec4 out[], size_t count) {
+  glm::mat4 m = toMat4(a);
+  parallelFor(count, AFFINE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      i += transformPaddedAvx2(a, points + begin, out + begin, end - begin);
+    }
+#endif
+    for (; i < end; ++i) {
+      out[i] = m * points[i];
+    }
+  });
+}
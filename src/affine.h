@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// 2D affine transform stored as the two basis columns and the translation
+// of a homogeneous mat3, without the constant bottom row.
+struct Affine2 {
+  glm::vec2 x;
+  glm::vec2 y;
+  glm::vec2 t;
+};
+
+// 3D affine transform stored as the top three rows of a homogeneous mat4;
+// row i is (m[0][i], m[1][i], m[2][i], translation[i]). Rows are vec4s so
+// each one fills an SSE register.
+struct Affine3 {
+  glm::vec4 rows[3];
+};
+
+inline Affine2 identityAffine2() {
+  return {glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec2(0.0f)};
+}
+
+inline Affine2 toAffine2(const glm::mat3 &m) {
+  return {glm::vec2(m[0]), glm::vec2(m[1]), glm::vec2(m[2])};
+}
+
+inline glm::mat3 toMat3(const Affine2 &a) {
+  return glm::mat3(glm::vec3(a.x, 0.0f), glm::vec3(a.y, 0.0f),
+                   glm::vec3(a.t, 1.0f));
+}
+
+// Expands a 2D affine transform to the mat4 the shaders expect.
+inline glm::mat4 toMat4(const Affine2 &a) {
+  glm::mat4 result(1.0f);
+  result[0] = glm::vec4(a.x, 0.0f, 0.0f);
+  result[1] = glm::vec4(a.y, 0.0f, 0.0f);
+  result[3] = glm::vec4(a.t, 0.0f, 1.0f);
+  return result;
+}
+
+inline glm::vec2 transformPoint(const Affine2 &a, const glm::vec2 &p) {
+  return a.x * p.x + a.y * p.y + a.t;
+}
+
+inline glm::vec2 transformVector(const Affine2 &a, const glm::vec2 &v) {
+  return a.x * v.x + a.y * v.y;
+}
+
+// a * b: applies b first. 8 multiplies against 27 for mat3.
+inline Affine2 composeAffine(const Affine2 &a, const Affine2 &b) {
+  return {transformVector(a, b.x), transformVector(a, b.y),
+          transformPoint(a, b.t)};
+}
+
+Affine2 inverseAffine(const Affine2 &a);
+
+Affine3 toAffine3(const glm::mat4 &m);
+glm::mat4 toMat4(const Affine3 &a);
+
+glm::vec3 transformPoint(const Affine3 &a, const glm::vec3 &p);
+glm::vec3 transformVector(const Affine3 &a, const glm::vec3 &v);
+Affine3 composeAffine(const Affine3 &a, const Affine3 &b);
+
+// Inverts through the adjugate of the 3x3 part. Singular transforms give
+// non-finite results, as glm::affineInverse does.
+Affine3 inverseAffine(const Affine3 &a);
+
+// Batch versions, split across threads for large inputs. Composition and
+// inversion use SSE; 2D and padded 3D point transforms use AVX2/FMA where
+// the CPU has it.
+// Outputs may alias inputs.
+void composeAffines(const Affine2 a[], const Affine2 b[], Affine2 out[],
+                    size_t count);
+void inverseAffines(const Affine2 a[], Affine2 out[], size_t count);
+void transformPoints(const Affine2 &a, const glm::vec2 points[],
+                     glm::vec2 out[], size_t count);
+void transformVectors(const Affine2 &a, const glm::vec2 vectors[],
+                      glm::vec2 out[], size_t count);
+
+void composeAffines(const Affine3 a[], const Affine3 b[], Affine3 out[],
+                    size_t count);
+void inverseAffines(const Affine3 a[], Affine3 out[], size_t count);
+void transformPoints(const Affine3 &a, const glm::vec3 points[],
+                     glm::vec3 out[], size_t count);
+
+// Padded storage: w is the homogeneous coordinate and is kept, so w = 1
+// transforms a point and w = 0 a direction. Two points per AVX2 register,
+// with no shuffling between the array and the lanes.
+void transformPoints(const Affine3 &a, const glm::vec4 points[],
+                     glm::vec4 out[], size_t count);
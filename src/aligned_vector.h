@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Cache-line alignment: a 32-byte AVX2 register never straddles two lines
+// when an array of vec2, vec4 or float starts on one.
+const size_t SIMD_ALIGNMENT = 64;
+
+// std::allocator with a stronger alignment guarantee, so vertex arrays start
+// on a cache line regardless of what malloc returns.
+template <typename T, size_t Alignment = SIMD_ALIGNMENT>
+struct AlignedAllocator {
+  static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0,
+                "alignment must be a power of two no weaker than the type's");
+
+  using value_type = T;
+
+  template <typename U> struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+  T *allocate(size_t count) {
+    return static_cast<T *>(
+        ::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+  }
+
+  void deallocate(T *data, size_t) {
+    ::operator delete(data, std::align_val_t(Alignment));
+  }
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment> &,
+                const AlignedAllocator<U, Alignment> &) {
+  return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment> &,
+                const AlignedAllocator<U, Alignment> &) {
+  return false;
+}
+
+template <typename T>
+using aligned_vector = std::vector<T, AlignedAllocator<T>>;
@@ -0,0 +1,36 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+Arena::Arena(size_t blockSize) : blockSize(blockSize) {}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+  if (!blocks.empty()) {
+    Block &block = blocks.back();
+    uintptr_t base = (uintptr_t)block.data.get();
+    uintptr_t start = (base + used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (start + size <= base + block.size) {
+      used = start + size - base;
+      allocated += size;
+      return (void *)start;
+    }
+  }
+
+  // Oversized requests get a block of their own; the padding guarantees the
+  // alignment regardless of what operator new returns.
+  Block block;
+  block.size = std::max(blockSize, size + alignment);
+  block.data.reset(new unsigned char[block.size]);
+  blocks.push_back(std::move(block));
+  used = 0;
+  return allocate(size, alignment);
+}
+
+void Arena::reset() {
+  if (blocks.size() > 1) {
+    blocks.erase(blocks.begin() + 1, blocks.end());
+  }
+  used = 0;
+  allocated = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for many small, short-lived objects that are released
+// together. Allocations are never freed individually; reset() drops them all
+// and keeps the first block for reuse.
+class Arena {
+public:
+  explicit Arena(size_t blockSize = 1 << 20);
+
+  void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  template <typename T> T *allocateArray(size_t count) {
+    return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void reset();
+  size_t bytesAllocated() const { return allocated; }
+
+private:
+  struct Block {
+    std::unique_ptr<unsigned char[]> data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks;
+  size_t blockSize;
+  size_t used = 0;
+  size_t allocated = 0;
+};
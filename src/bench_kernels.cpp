@@ -0,0 +1,919 @@
+// Benchmarks for the CPU kernels used by task2. Needs no window or GL
+// context, so it runs on headless machines:
+//
+//   ./bench_kernels            all benchmarks
+//   ./bench_kernels morton     one benchmark
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtc/color_space.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/component_wise.hpp>
+#include <glm/gtx/dual_quaternion.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtx/normal.hpp>
+#include <glm/gtx/spline.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "affine.h"
+#include "aligned_vector.h"
+#include "bvh.h"
+#include "color_space.h"
+#include "curve_batch.h"
+#include "decompose.h"
+#include "mesh_normals.h"
+#include "morton.h"
+#include "normalize.h"
+#include "quat_batch.h"
+#include "reduce.h"
+#include "simd.h"
+
+double getSeconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void printTime(const char *label, double seconds) {
+  std::cout << "  " << label << ": " << seconds * 1000.0 << " ms" << std::endl;
+}
+
+std::vector<AABB> getRandomBoxes(int count) {
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<float> position(-1.0, 1.0);
+  std::uniform_real_distribution<float> size(0.0005, 0.002);
+  std::vector<AABB> boxes(count);
+  for (AABB &box : boxes) {
+    box.min = glm::vec2(position(rng), position(rng));
+    box.max = box.min + glm::vec2(size(rng), size(rng));
+  }
+  return boxes;
+}
+
+void benchMorton() {
+  const int COUNT = 10000000;
+  std::cout << "Morton codes and linear BVH (" << COUNT << " boxes, "
+            << (cpuHasBmi2() ? "bmi2" : "no bmi2") << ")" << std::endl;
+
+  std::vector<AABB> boxes = getRandomBoxes(COUNT);
+  std::vector<glm::vec2> centers(COUNT);
+  AABB bounds = emptyAABB();
+  for (int i = 0; i < COUNT; ++i) {
+    centers[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+    expandAABB(bounds, centers[i]);
+  }
+
+  std::vector<uint32_t> codes(COUNT);
+  double start = getSeconds();
+  encodeMorton2D(centers.data(), COUNT, bounds, codes.data());
+  printTime("encode", getSeconds() - start);
+
+  std::vector<int> order(COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    order[i] = i;
+  }
+  start = getSeconds();
+  radixSortMorton(codes, order);
+  printTime("radix sort", getSeconds() - start);
+
+  Bvh linear, median;
+  start = getSeconds();
+  linear.buildLinear(boxes);
+  printTime("linear build", getSeconds() - start);
+  start = getSeconds();
+  median.build(boxes);
+  printTime("median build", getSeconds() - start);
+
+  // Both trees must return the same primitives.
+  AABB view = {glm::vec2(-0.1, -0.1), glm::vec2(0.1, 0.1)};
+  std::vector<int> linearHits, medianHits;
+  start = getSeconds();
+  linear.query(boxes, view, linearHits);
+  printTime("linear query", getSeconds() - start);
+  start = getSeconds();
+  median.query(boxes, view, medianHits);
+  printTime("median query", getSeconds() - start);
+  std::cout << "  hits: " << linearHits.size() << " / " << medianHits.size()
+            << std::endl;
+}
+
+glm::quat getRandomQuat(std::mt19937 &rng) {
+  std::normal_distribution<float> normal;
+  return glm::normalize(
+      glm::quat(normal(rng), normal(rng), normal(rng), normal(rng)));
+}
+
+void benchQuat() {
+  const int COUNT = 1000000;
+  const int BONES = 64;
+  std::cout << "Quaternion blending and skinning (" << COUNT << " items, "
+            << (cpuHasAvx2() ? "avx2" : "no avx2") << ")" << std::endl;
+
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<float> unit(0.0, 1.0);
+  std::vector<float> a(4 * COUNT), b(4 * COUNT), out(4 * COUNT), t(COUNT);
+  std::vector<glm::quat> qa(COUNT), qb(COUNT), expected(COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    qa[i] = getRandomQuat(rng);
+    qb[i] = getRandomQuat(rng);
+    t[i] = unit(rng);
+    for (int c = 0; c < 4; ++c) {
+      a[c * COUNT + i] = qa[i][c];
+      b[c * COUNT + i] = qb[i][c];
+    }
+  }
+  QuatArrays arraysA = {&a[0], &a[COUNT], &a[2 * COUNT], &a[3 * COUNT]};
+  QuatArrays arraysB = {&b[0], &b[COUNT], &b[2 * COUNT], &b[3 * COUNT]};
+  QuatArrays arraysOut = {&out[0], &out[COUNT], &out[2 * COUNT],
+                          &out[3 * COUNT]};
+
+  double start = getSeconds();
+  for (int i = 0; i < COUNT; ++i) {
+    expected[i] = glm::slerp(qa[i], qb[i], t[i]);
+  }
+  printTime("glm::slerp", getSeconds() - start);
+
+  start = getSeconds();
+  nlerpQuats(arraysA, arraysB, t.data(), arraysOut, COUNT);
+  printTime("nlerp", getSeconds() - start);
+
+  start = getSeconds();
+  slerpQuats(arraysA, arraysB, t.data(), arraysOut, COUNT);
+  printTime("slerp", getSeconds() - start);
+
+  // glm::slerp does not flip to the shorter arc, so compare up to sign.
+  float maxError = 0.0f;
+  for (int i = 0; i < COUNT; ++i) {
+    glm::vec4 got(out[i], out[COUNT + i], out[2 * COUNT + i],
+                  out[3 * COUNT + i]);
+    glm::quat slerped = glm::dot(qa[i], qb[i]) < 0.0f
+                            ? glm::slerp(qa[i], -qb[i], t[i])
+                            : expected[i];
+    glm::vec4 want(slerped.x, slerped.y, slerped.z, slerped.w);
+    glm::vec4 diff = glm::abs(got - want);
+    maxError = std::max(maxError, std::max(std::max(diff.x, diff.y),
+                                           std::max(diff.z, diff.w)));
+  }
+  std::cout << "  slerp max error: " << maxError << std::endl;
+
+  std::vector<SkinBone> bones(BONES);
+  std::vector<glm::dualquat> reference(BONES);
+  std::uniform_real_distribution<float> offset(-1.0, 1.0);
+  for (int j = 0; j < BONES; ++j) {
+    glm::quat rotation = getRandomQuat(rng);
+    glm::vec3 translation(offset(rng), offset(rng), offset(rng));
+    bones[j] = makeSkinBone(rotation, translation);
+    reference[j] = glm::dualquat(rotation, translation);
+  }
+  std::vector<glm::vec3> positions(COUNT), skinned(COUNT);
+  std::vector<glm::ivec4> joints(COUNT);
+  std::vector<glm::vec4> weights(COUNT);
+  std::uniform_int_distribution<int> bone(0, BONES - 1);
+  for (int i = 0; i < COUNT; ++i) {
+    positions[i] = glm::vec3(offset(rng), offset(rng), offset(rng));
+    joints[i] = glm::ivec4(bone(rng), bone(rng), bone(rng), bone(rng));
+    glm::vec4 w(unit(rng), unit(rng), unit(rng), unit(rng));
+    weights[i] = w / (w.x + w.y + w.z + w.w);
+  }
+
+  start = getSeconds();
+  skinDualQuat(bones.data(), BONES, positions.data(), joints.data(),
+               weights.data(), COUNT, skinned.data());
+  printTime("dual quaternion skinning", getSeconds() - start);
+
+  maxError = 0.0f;
+  for (int i = 0; i < COUNT; i += 97) {
+    glm::dualquat pivot = reference[joints[i][0]];
+    glm::dualquat blend = glm::dualquat(glm::quat(0, 0, 0, 0),
+                                        glm::quat(0, 0, 0, 0));
+    for (int k = 0; k < 4; ++k) {
+      glm::dualquat dq = reference[joints[i][k]];
+      float w = weights[i][k];
+      if (glm::dot(dq.real, pivot.real) < 0.0f) {
+        w = -w;
+      }
+      blend.real = blend.real + dq.real * w;
+      blend.dual = blend.dual + dq.dual * w;
+    }
+    glm::vec3 want = glm::normalize(blend) * positions[i];
+    maxError = std::max(maxError, glm::length(skinned[i] - want));
+  }
+  std::cout << "  skinning max error: " << maxError << std::endl;
+}
+
+float getMaxDifference(const glm::mat4 &a, const glm::mat4 &b) {
+  float difference = 0.0f;
+  for (int i = 0; i < 4; ++i) {
+    glm::vec4 d = glm::abs(a[i] - b[i]);
+    difference = std::max(difference, std::max(std::max(d.x, d.y),
+                                               std::max(d.z, d.w)));
+  }
+  return difference;
+}
+
+// Largest difference scaled by the largest entry of b, so that inverses of
+// nearly singular transforms do not dominate.
+float getRelativeDifference(const glm::mat4 &a, const glm::mat4 &b) {
+  float scale = 1.0f;
+  for (int i = 0; i < 4; ++i) {
+    glm::vec4 m = glm::abs(b[i]);
+    scale = std::max(scale, std::max(std::max(m.x, m.y), std::max(m.z, m.w)));
+  }
+  return getMaxDifference(a, b) / scale;
+}
+
+void benchAffine() {
+  const int COUNT = 1000000;
+  const int POINTS = 10000000;
+  std::cout << "Affine transforms (" << COUNT << " transforms, " << POINTS
+            << " points)" << std::endl;
+
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<float> value(-2.0, 2.0);
+  std::vector<glm::mat3> mat3s(COUNT);
+  std::vector<glm::mat4> mat4s(COUNT);
+  std::vector<Affine2> affine2s(COUNT), affine2Out(COUNT);
+  std::vector<Affine3> affine3s(COUNT), affine3Out(COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    affine2s[i] = {glm::vec2(value(rng), value(rng)),
+                   glm::vec2(value(rng), value(rng)),
+                   glm::vec2(value(rng), value(rng))};
+    mat3s[i] = toMat3(affine2s[i]);
+    mat4s[i] = glm::mat4(1.0f);
+    for (int c = 0; c < 4; ++c) {
+      mat4s[i][c] = glm::vec4(value(rng), value(rng), value(rng), c == 3);
+    }
+    affine3s[i] = toAffine3(mat4s[i]);
+  }
+
+  std::vector<glm::mat3> mat3Out(COUNT);
+  double start = getSeconds();
+  for (int i = 0; i < COUNT; ++i) {
+    mat3Out[i] = mat3s[i] * mat3s[(i + 1) % COUNT];
+  }
+  printTime("mat3 compose", getSeconds() - start);
+  std::vector<Affine2> shifted(affine2s.begin() + 1, affine2s.end());
+  shifted.push_back(affine2s[0]);
+  start = getSeconds();
+  composeAffines(affine2s.data(), shifted.data(), affine2Out.data(), COUNT);
+  printTime("Affine2 compose", getSeconds() - start);
+  float maxError = 0.0f;
+  for (int i = 0; i < COUNT; ++i) {
+    maxError = std::max(maxError, 
+                        getMaxDifference(toMat4(affine2Out[i]),
+                                         toMat4(toAffine2(mat3Out[i]))));
+  }
+
+  start = getSeconds();
+  for (int i = 0; i < COUNT; ++i) {
+    mat3Out[i] = glm::affineInverse(mat3s[i]);
+  }
+  printTime("mat3 affineInverse", getSeconds() - start);
+  start = getSeconds();
+  inverseAffines(affine2s.data(), affine2Out.data(), COUNT);
+  printTime("Affine2 inverse", getSeconds() - start);
+  float maxInverseError = 0.0f;
+  for (int i = 0; i < COUNT; i += 97) {
+    glm::mat4 expected = toMat4(toAffine2(mat3Out[i]));
+    maxInverseError =
+        std::max(maxInverseError,
+                 getRelativeDifference(toMat4(affine2Out[i]), expected));
+  }
+
+  std::vector<glm::mat4> mat4Out(COUNT);
+  start = getSeconds();
+  for (int i = 0; i < COUNT; ++i) {
+    mat4Out[i] = mat4s[i] * mat4s[(i + 1) % COUNT];
+  }
+  printTime("mat4 compose", getSeconds() - start);
+  std::vector<Affine3> shifted3(affine3s.begin() + 1, affine3s.end());
+  shifted3.push_back(affine3s[0]);
+  start = getSeconds();
+  composeAffines(affine3s.data(), shifted3.data(), affine3Out.data(), COUNT);
+  printTime("Affine3 compose", getSeconds() - start);
+  for (int i = 0; i < COUNT; i += 97) {
+    maxError = std::max(maxError,
+                        getMaxDifference(toMat4(affine3Out[i]), mat4Out[i]));
+  }
+
+  start = getSeconds();
+  for (int i = 0; i < COUNT; ++i) {
+    mat4Out[i] = glm::affineInverse(mat4s[i]);
+  }
+  printTime("mat4 affineInverse", getSeconds() - start);
+  start = getSeconds();
+  inverseAffines(affine3s.data(), affine3Out.data(), COUNT);
+  printTime("Affine3 inverse", getSeconds() - start);
+  for (int i = 0; i < COUNT; i += 97) {
+    maxInverseError =
+        std::max(maxInverseError,
+                 getRelativeDifference(toMat4(affine3Out[i]), mat4Out[i]));
+  }
+
+  std::vector<glm::vec2> points(POINTS), transformed(POINTS);
+  for (glm::vec2 &point : points) {
+    point = glm::vec2(value(rng), value(rng));
+  }
+  start = getSeconds();
+  for (int i = 0; i < POINTS; ++i) {
+    transformed[i] = glm::vec2(mat3s[0] * glm::vec3(points[i], 1.0f));
+  }
+  printTime("mat3 points", getSeconds() - start);
+  start = getSeconds();
+  transformPoints(affine2s[0], points.data(), points.data(), POINTS);
+  printTime("Affine2 points", getSeconds() - start);
+  float maxPointError = 0.0f;
+  for (int i = 0; i < POINTS; ++i) {
+    glm::vec2 d = glm::abs(points[i] - transformed[i]);
+    maxPointError = std::max(maxPointError, std::max(d.x, d.y));
+  }
+
+  std::vector<glm::vec3> points3(POINTS / 2), transformed3(POINTS / 2);
+  for (glm::vec3 &point : points3) {
+    point = glm::vec3(value(rng), value(rng), value(rng));
+  }
+  start = getSeconds();
+  for (int i = 0; i < POINTS / 2; ++i) {
+    transformed3[i] = glm::vec3(mat4s[0] * glm::vec4(points3[i], 1.0f));
+  }
+  printTime("mat4 points", getSeconds() - start);
+  start = getSeconds();
+  transformPoints(affine3s[0], points3.data(), points3.data(), POINTS / 2);
+  printTime("Affine3 points", getSeconds() - start);
+  for (int i = 0; i < POINTS / 2; ++i) {
+    glm::vec3 d = glm::abs(points3[i] - transformed3[i]);
+    maxPointError = std::max(maxPointError, std::max(std::max(d.x, d.y), d.z));
+  }
+
+  std::cout << "  max error: compose " << maxError << ", inverse (relative) "
+            << maxInverseError << ", points " << maxPointError << std::endl;
+}
+
+void benchCurves() {
+  const int COUNT = 1000000;
+  const int POINTS = 8;
+  std::cout << "Easing and splines (" << COUNT << " values)" << std::endl;
+
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<float> unit(0.0, 1.0);
+  std::vector<float> t(COUNT), eased(COUNT), expected(COUNT);
+  for (float &value : t) {
+    value = unit(rng);
+  }
+
+  for (int type = 0; type < EASE_TYPE_COUNT; ++type) {
+    EaseType ease = (EaseType)type;
+    double start = getSeconds();
+    evaluateEasing(ease, t.data(), eased.data(), COUNT);
+    double seconds = getSeconds() - start;
+    // Single values take the scalar path, which calls glm directly.
+    float maxError = 0.0f;
+    for (int i = 0; i < COUNT; i += 7) {
+      float want;
+      evaluateEasing(ease, &t[i], &want, 1);
+      maxError = std::max(maxError, std::abs(eased[i] - want));
+    }
+    std::cout << "  " << getEaseName(ease) << ": " << seconds * 1000.0
+              << " ms, max error " << maxError << std::endl;
+  }
+
+  std::vector<float> points(COUNT * POINTS);
+  for (float &point : points) {
+    point = unit(rng);
+  }
+  CubicCurves curves;
+  double start = getSeconds();
+  buildCatmullRomCurves(points.data(), COUNT, POINTS, curves);
+  printTime("Catmull-Rom build", getSeconds() - start);
+  start = getSeconds();
+  evaluateCurves(curves, t.data(), eased.data());
+  printTime("Catmull-Rom evaluate", getSeconds() - start);
+
+  start = getSeconds();
+  for (int i = 0; i < COUNT; ++i) {
+    const float *p = &points[i * POINTS];
+    float x = t[i] * (POINTS - 1);
+    int s = std::min((int)x, POINTS - 2);
+    glm::vec1 v = glm::catmullRom(
+        glm::vec1(p[std::max(s - 1, 0)]), glm::vec1(p[s]),
+        glm::vec1(p[s + 1]), glm::vec1(p[std::min(s + 2, POINTS - 1)]),
+        x - s);
+    expected[i] = v.x;
+  }
+  printTime("glm::catmullRom", getSeconds() - start);
+  float maxError = 0.0f;
+  for (int i = 0; i < COUNT; ++i) {
+    maxError = std::max(maxError, std::abs(eased[i] - expected[i]));
+  }
+  std::cout << "  Catmull-Rom max error: " << maxError << std::endl;
+
+  // Curves driven by one clock read the same coefficient row.
+  std::fill(t.begin(), t.end(), 0.37f);
+  start = getSeconds();
+  evaluateCurves(curves, t.data(), eased.data());
+  printTime("Catmull-Rom evaluate, shared time", getSeconds() - start);
+}
+
+void benchSrgb() {
+  const int WIDTH = 3840, HEIGHT = 2160;
+  const size_t COUNT = (size_t)WIDTH * HEIGHT * 4;
+  std::cout << "sRGB conversion (" << WIDTH << "x" << HEIGHT << " RGBA)"
+            << std::endl;
+
+  std::mt19937 rng(2319);
+  std::vector<uint8_t> pixels(COUNT), encoded(COUNT);
+  for (uint8_t &pixel : pixels) {
+    pixel = rng() & 0xFF;
+  }
+  std::vector<float> linear(COUNT), expected(COUNT), srgb(COUNT);
+
+  double start = getSeconds();
+  for (size_t i = 0; i < COUNT; i += 4) {
+    glm::vec4 c = glm::convertSRGBToLinear(
+        glm::vec4(pixels[i], pixels[i + 1], pixels[i + 2], pixels[i + 3]) /
+        255.0f);
+    expected[i] = c.r;
+    expected[i + 1] = c.g;
+    expected[i + 2] = c.b;
+    expected[i + 3] = c.a;
+  }
+  printTime("glm::convertSRGBToLinear", getSeconds() - start);
+  start = getSeconds();
+  srgb8ToLinear(pixels.data(), linear.data(), COUNT);
+  printTime("srgb8ToLinear", getSeconds() - start);
+  // glm passes alpha through, so only the color channels are compared.
+  float maxError = 0.0f;
+  for (size_t i = 0; i < COUNT; ++i) {
+    if (i % 4 != 3) {
+      maxError = std::max(maxError, std::abs(linear[i] - expected[i]));
+    }
+  }
+  std::cout << "  srgb8ToLinear max difference from glm: " << maxError
+            << std::endl;
+
+  start = getSeconds();
+  for (size_t i = 0; i < COUNT; i += 4) {
+    glm::vec4 c = glm::convertLinearToSRGB(glm::vec4(
+        linear[i], linear[i + 1], linear[i + 2], linear[i + 3]));
+    expected[i] = c.r;
+    expected[i + 1] = c.g;
+    expected[i + 2] = c.b;
+    expected[i + 3] = c.a;
+  }
+  printTime("glm::convertLinearToSRGB", getSeconds() - start);
+  start = getSeconds();
+  linearToSrgb(linear.data(), srgb.data(), COUNT);
+  printTime("linearToSrgb", getSeconds() - start);
+  start = getSeconds();
+  linearToSrgb8(linear.data(), encoded.data(), COUNT);
+  printTime("linearToSrgb8", getSeconds() - start);
+
+  // The round trip must give back every byte.
+  maxError = 0.0f;
+  size_t mismatches = 0;
+  for (size_t i = 0; i < COUNT; ++i) {
+    if (i % 4 != 3) {
+      maxError = std::max(maxError, std::abs(srgb[i] - expected[i]));
+    }
+    mismatches += encoded[i] != pixels[i];
+  }
+  std::cout << "  linearToSrgb max difference from glm: " << maxError
+            << ", round trip mismatches: " << mismatches << std::endl;
+}
+
+// Largest distance of any component from the double precision result, in
+// units in the last place of that result rounded to float.
+template <int D>
+double getMaxUlpError(const std::vector<glm::vec<D, float>> &in,
+                      const std::vector<glm::vec<D, float>> &out) {
+  const float INF = std::numeric_limits<float>::infinity();
+  double maxError = 0.0;
+  for (size_t i = 0; i < in.size(); ++i) {
+    glm::vec<D, double> exact = glm::normalize(glm::vec<D, double>(in[i]));
+    for (int d = 0; d < D; ++d) {
+      float rounded = std::abs((float)exact[d]);
+      double ulp = std::nextafter(rounded, INF) - rounded;
+      maxError = std::max(maxError, std::abs(out[i][d] - exact[d]) / ulp);
+    }
+  }
+  return maxError;
+}
+
+void printNormalize(const std::string &label, size_t count, double seconds,
+                    double ulpError) {
+  std::cout << "  " << label << ": " << seconds * 1000.0 << " ms, "
+            << count / seconds * 1e-6 << " M/s, max " << ulpError << " ulp"
+            << std::endl;
+}
+
+template <int D> void benchNormalizeDimension(size_t count) {
+  typedef glm::vec<D, float> Vector;
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+  std::vector<Vector> in(count), out(count);
+  for (Vector &v : in) {
+    for (int d = 0; d < D; ++d) {
+      v[d] = value(rng);
+    }
+  }
+  std::string name = "vec" + std::to_string(D);
+
+  double start = getSeconds();
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = glm::normalize(in[i]);
+  }
+  double seconds = getSeconds() - start;
+  printNormalize(name + " glm::normalize", count, seconds,
+                 getMaxUlpError(in, out));
+
+  const NormalizeMode MODES[] = {NORMALIZE_FAST, NORMALIZE_REFINED,
+                                 NORMALIZE_EXACT};
+  for (NormalizeMode mode : MODES) {
+    start = getSeconds();
+    normalizeVectors(in.data(), out.data(), count, mode);
+    seconds = getSeconds() - start;
+    printNormalize(name + " AoS " + getNormalizeModeName(mode), count,
+                   seconds, getMaxUlpError(in, out));
+  }
+
+  std::vector<float> arrays[D];
+  float *components[D];
+  for (int d = 0; d < D; ++d) {
+    arrays[d].resize(count);
+    components[d] = arrays[d].data();
+  }
+  for (NormalizeMode mode : MODES) {
+    for (size_t i = 0; i < count; ++i) {
+      for (int d = 0; d < D; ++d) {
+        arrays[d][i] = in[i][d];
+      }
+    }
+    start = getSeconds();
+    normalizeArrays(components, D, count, mode);
+    seconds = getSeconds() - start;
+    for (size_t i = 0; i < count; ++i) {
+      for (int d = 0; d < D; ++d) {
+        out[i][d] = arrays[d][i];
+      }
+    }
+    printNormalize(name + " SoA " + getNormalizeModeName(mode), count,
+                   seconds, getMaxUlpError(in, out));
+  }
+}
+
+void benchNormalize() {
+  const size_t COUNT = 4000000;
+  std::cout << "Normalize (" << COUNT << " vectors)" << std::endl;
+  benchNormalizeDimension<2>(COUNT);
+  benchNormalizeDimension<3>(COUNT);
+  benchNormalizeDimension<4>(COUNT);
+}
+
+void benchNormals() {
+  // A wavy height field split into two triangles per grid cell.
+  const int SIDE = 3163;
+  const size_t VERTICES = (size_t)SIDE * SIDE;
+  const size_t TRIANGLES = (size_t)(SIDE - 1) * (SIDE - 1) * 2;
+  std::cout << "Mesh normals (" << TRIANGLES << " triangles)" << std::endl;
+
+  std::vector<glm::vec3> positions(VERTICES);
+  std::vector<glm::vec2> texCoords(VERTICES);
+  for (int y = 0; y < SIDE; ++y) {
+    for (int x = 0; x < SIDE; ++x) {
+      size_t v = (size_t)y * SIDE + x;
+      texCoords[v] = glm::vec2(x, y) / (float)(SIDE - 1);
+      positions[v] = glm::vec3(x, y, std::sin(x * 0.05f) * std::cos(y * 0.07f));
+    }
+  }
+  std::vector<uint32_t> indices;
+  indices.reserve(TRIANGLES * 3);
+  for (int y = 0; y + 1 < SIDE; ++y) {
+    for (int x = 0; x + 1 < SIDE; ++x) {
+      uint32_t v = y * SIDE + x;
+      uint32_t quad[6] = {v, v + 1, v + SIDE, v + 1, v + SIDE + 1, v + SIDE};
+      indices.insert(indices.end(), quad, quad + 6);
+    }
+  }
+
+  std::vector<glm::vec3> expected(TRIANGLES), faces(TRIANGLES);
+  double start = getSeconds();
+  for (size_t i = 0; i < TRIANGLES; ++i) {
+    const uint32_t *t = &indices[i * 3];
+    expected[i] = glm::triangleNormal(positions[t[0]], positions[t[1]],
+                                      positions[t[2]]);
+  }
+  printTime("glm::triangleNormal", getSeconds() - start);
+  start = getSeconds();
+  computeFaceNormals(positions.data(), indices.data(), TRIANGLES,
+                     faces.data());
+  printTime("computeFaceNormals", getSeconds() - start);
+  float maxError = 0.0f;
+  for (size_t i = 0; i < TRIANGLES; ++i) {
+    maxError = std::max(maxError, glm::length(faces[i] - expected[i]));
+  }
+  std::cout << "  face normal max difference: " << maxError << std::endl;
+
+  std::vector<glm::vec3> smooth(VERTICES);
+  start = getSeconds();
+  expected.assign(VERTICES, glm::vec3(0.0f));
+  for (size_t i = 0; i < TRIANGLES; ++i) {
+    const uint32_t *t = &indices[i * 3];
+    glm::vec3 a = positions[t[0]];
+    glm::vec3 n = glm::cross(positions[t[1]] - a, positions[t[2]] - a);
+    expected[t[0]] += n;
+    expected[t[1]] += n;
+    expected[t[2]] += n;
+  }
+  for (glm::vec3 &n : expected) {
+    n = glm::normalize(n);
+  }
+  printTime("scalar vertex normals", getSeconds() - start);
+  start = getSeconds();
+  computeVertexNormals(positions.data(), VERTICES, indices.data(), TRIANGLES,
+                       smooth.data());
+  printTime("computeVertexNormals", getSeconds() - start);
+  maxError = 0.0f;
+  for (size_t v = 0; v < VERTICES; ++v) {
+    maxError = std::max(maxError, glm::length(smooth[v] - expected[v]));
+  }
+  std::cout << "  vertex normal max difference: " << maxError << std::endl;
+
+  std::vector<glm::vec4> tangents(VERTICES);
+  start = getSeconds();
+  computeVertexTangents(positions.data(), texCoords.data(), smooth.data(),
+                        VERTICES, indices.data(), TRIANGLES, tangents.data());
+  printTime("computeVertexTangents", getSeconds() - start);
+  // u runs along x, so tangents should stay close to +x with w = 1.
+  float minAlong = 1.0f;
+  for (const glm::vec4 &t : tangents) {
+    minAlong = std::min(minAlong, t.x * t.w);
+  }
+  std::cout << "  smallest tangent x: " << minAlong << std::endl;
+}
+
+void printBandwidth(const char *label, size_t bytes, double seconds) {
+  std::cout << "  " << label << ": " << seconds * 1000.0 << " ms, "
+            << bytes / seconds * 1e-9 << " GB/s" << std::endl;
+}
+
+void benchReduce() {
+  const size_t COUNT = 16000000;
+  std::cout << "Reductions (" << COUNT << " points)" << std::endl;
+
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<float> value(-1000.0f, 1000.0f);
+  std::vector<glm::vec3> points(COUNT);
+  for (glm::vec3 &p : points) {
+    p = glm::vec3(value(rng), value(rng), value(rng) + 500.0f);
+  }
+  size_t bytes = COUNT * sizeof(glm::vec3);
+
+  double start = getSeconds();
+  glm::vec3 expectedMin(FLT_MAX), expectedMax(-FLT_MAX);
+  for (const glm::vec3 &p : points) {
+    expectedMin = glm::min(expectedMin, p);
+    expectedMax = glm::max(expectedMax, p);
+  }
+  printBandwidth("glm::min/max loop", bytes, getSeconds() - start);
+  glm::vec3 min, max;
+  start = getSeconds();
+  getBounds(points.data(), COUNT, min, max);
+  printBandwidth("getBounds vec3", bytes, getSeconds() - start);
+  std::cout << "  bounds match: "
+            << (min == expectedMin && max == expectedMax ? "yes" : "no")
+            << std::endl;
+
+  start = getSeconds();
+  glm::dvec3 expectedSum(0.0);
+  for (const glm::vec3 &p : points) {
+    expectedSum += glm::dvec3(p);
+  }
+  printBandwidth("scalar double sum", bytes, getSeconds() - start);
+  start = getSeconds();
+  glm::dvec3 sum = getSum(points.data(), COUNT);
+  printBandwidth("getSum vec3", bytes, getSeconds() - start);
+  std::cout << "  mean: " << sum.x / COUNT << " " << sum.y / COUNT << " "
+            << sum.z / COUNT << ", max difference from scalar sum: "
+            << glm::compMax(glm::abs(sum - expectedSum)) << std::endl;
+
+  // The 2D generators take their culling bounds this way.
+  std::vector<glm::vec2> flat(COUNT);
+  for (size_t i = 0; i < COUNT; ++i) {
+    flat[i] = glm::vec2(points[i]);
+  }
+  start = getSeconds();
+  AABB expected = emptyAABB();
+  for (const glm::vec2 &p : flat) {
+    expandAABB(expected, p);
+  }
+  printBandwidth("expandAABB loop", COUNT * sizeof(glm::vec2),
+                 getSeconds() - start);
+  start = getSeconds();
+  AABB box = getBounds(flat.data(), COUNT);
+  printBandwidth("getBounds vec2", COUNT * sizeof(glm::vec2),
+                 getSeconds() - start);
+  std::cout << "  bounds match: "
+            << (box.min == expected.min && box.max == expected.max ? "yes"
+                                                                     : "no")
+            << std::endl;
+}
+
+void benchDecompose() {
+  const size_t COUNT = 2000000;
+  std::cout << "Matrix decomposition (" << COUNT << " matrices)" << std::endl;
+
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+  std::vector<glm::mat4> trs(COUNT), skewed(COUNT);
+  std::vector<glm::mat3> linear(COUNT);
+  std::vector<glm::quat> truth(COUNT);
+  for (size_t i = 0; i < COUNT; ++i) {
+    truth[i] = glm::normalize(
+        glm::quat(value(rng), value(rng), value(rng), value(rng)));
+    glm::vec3 scale(1.5f + value(rng), 1.5f + value(rng), 1.5f + value(rng));
+    glm::vec3 translation(value(rng), value(rng), value(rng));
+    trs[i] = glm::translate(glm::mat4(1.0f), translation * 10.0f) *
+             glm::mat4_cast(truth[i]) * glm::scale(glm::mat4(1.0f), scale);
+    skewed[i] = trs[i];
+    skewed[i][1] += skewed[i][0] * 0.3f * value(rng);
+    // A rotation times a random symmetric positive definite stretch.
+    glm::mat3 a(value(rng), value(rng), value(rng), value(rng), value(rng),
+                value(rng), value(rng), value(rng), value(rng));
+    linear[i] = glm::mat3_cast(truth[i]) *
+                (glm::transpose(a) * a + glm::mat3(0.2f));
+  }
+
+  std::vector<TransformParts> expected(COUNT), parts(COUNT);
+  glm::vec4 perspective;
+  double start = getSeconds();
+  for (size_t i = 0; i < COUNT; ++i) {
+    TransformParts &e = expected[i];
+    glm::decompose(skewed[i], e.scale, e.rotation, e.translation, e.skew,
+                   perspective);
+  }
+  printTime("glm::decompose", getSeconds() - start);
+  start = getSeconds();
+  size_t failures = decomposeTransforms(skewed.data(), parts.data(), COUNT);
+  printTime("decomposeTransforms", getSeconds() - start);
+  float maxError = 0.0f;
+  for (size_t i = 0; i < COUNT; ++i) {
+    const TransformParts &e = expected[i], &p = parts[i];
+    maxError = std::max({maxError, glm::compMax(glm::abs(p.scale - e.scale)),
+                         glm::compMax(glm::abs(p.skew - e.skew)),
+                         glm::length(glm::vec4(p.rotation.x - e.rotation.x,
+                                               p.rotation.y - e.rotation.y,
+                                               p.rotation.z - e.rotation.z,
+                                               p.rotation.w - e.rotation.w))});
+  }
+  std::cout << "  failures: " << failures
+            << ", max difference from glm: " << maxError << std::endl;
+
+  start = getSeconds();
+  decomposeTrs(trs.data(), parts.data(), COUNT);
+  printTime("decomposeTrs", getSeconds() - start);
+  maxError = 0.0f;
+  for (size_t i = 0; i < COUNT; ++i) {
+    maxError = std::max(
+        maxError, 1.0f - std::abs(glm::dot(parts[i].rotation, truth[i])));
+  }
+  std::cout << "  TRS rotation max error (1 - |dot|): " << maxError
+            << std::endl;
+
+  std::vector<glm::quat> rotations(COUNT);
+  std::vector<glm::mat3> stretches(COUNT);
+  start = getSeconds();
+  polarDecompose(linear.data(), rotations.data(), stretches.data(), COUNT);
+  printTime("polarDecompose", getSeconds() - start);
+  maxError = 0.0f;
+  for (size_t i = 0; i < COUNT; ++i) {
+    maxError = std::max(
+        maxError, 1.0f - std::abs(glm::dot(rotations[i], truth[i])));
+  }
+  std::cout << "  polar rotation max error (1 - |dot|): " << maxError
+            << std::endl;
+}
+
+// Best of runs calls, so that small cache-resident inputs are not dominated
+// by timer resolution and page faults.
+template <typename F> double getBestSeconds(int runs, const F &fn) {
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < runs; ++run) {
+    double start = getSeconds();
+    fn();
+    best = std::min(best, getSeconds() - start);
+  }
+  return best;
+}
+
+template <typename Vector>
+void benchLayout(const std::string &name, const Affine3 &a, Vector in[],
+                 Vector out[], size_t count, int runs) {
+  size_t bytes = 2 * count * sizeof(Vector);
+  double seconds = getBestSeconds(
+      runs, [&] { transformPoints(a, in, out, count); });
+  printBandwidth((name + " transformPoints").c_str(), bytes, seconds);
+  seconds = getBestSeconds(runs, [&] {
+    normalizeVectors(in, out, count, NORMALIZE_EXACT);
+  });
+  printBandwidth((name + " normalizeVectors").c_str(), bytes, seconds);
+}
+
+// Compares vec3 arrays at malloc's alignment, at a cache line and a float
+// past one, against vec4 padding, which keeps every vector inside one
+// 16-byte slot.
+void benchAlignedCount(size_t count, int runs) {
+  std::cout << " " << count << " vectors, best of " << runs << std::endl;
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+  Affine3 a = toAffine3(
+      glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, -2.0f, 3.0f)) *
+      glm::rotate(glm::mat4(1.0f), 0.7f, glm::vec3(0.0f, 0.6f, 0.8f)));
+
+  std::vector<glm::vec3> heap(count), heapOut(count);
+  for (glm::vec3 &v : heap) {
+    v = glm::vec3(value(rng), value(rng), value(rng));
+  }
+  aligned_vector<glm::vec3> aligned(heap.begin(), heap.end()),
+      alignedOut(count);
+  aligned_vector<float> offsetFloats(count * 3 + 1),
+      offsetOutFloats(count * 3 + 1);
+  glm::vec3 *offset = (glm::vec3 *)(offsetFloats.data() + 1);
+  glm::vec3 *offsetOut = (glm::vec3 *)(offsetOutFloats.data() + 1);
+  std::copy(heap.begin(), heap.end(), offset);
+  aligned_vector<glm::vec4> padded(count), paddedOut(count);
+  for (size_t i = 0; i < count; ++i) {
+    padded[i] = glm::vec4(heap[i], 1.0f);
+  }
+
+  benchLayout("vec3 std::vector", a, heap.data(), heapOut.data(), count, runs);
+  benchLayout("vec3 offset", a, offset, offsetOut, count, runs);
+  benchLayout("vec3 aligned_vector", a, aligned.data(), alignedOut.data(),
+              count, runs);
+
+  // w = 1 makes the padded transform a point transform; the normalize that
+  // follows needs w = 0 to match vec3.
+  transformPoints(a, padded.data(), paddedOut.data(), count);
+  transformPoints(a, aligned.data(), alignedOut.data(), count);
+  float maxError = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    glm::vec3 d = glm::abs(glm::vec3(paddedOut[i]) - alignedOut[i]);
+    maxError = std::max(maxError, glm::compMax(d));
+  }
+  for (glm::vec4 &v : padded) {
+    v.w = 0.0f;
+  }
+  benchLayout("vec4 padded", a, padded.data(), paddedOut.data(), count, runs);
+  normalizeVectors(aligned.data(), alignedOut.data(), count, NORMALIZE_EXACT);
+  for (size_t i = 0; i < count; ++i) {
+    glm::vec3 d = glm::abs(glm::vec3(paddedOut[i]) - alignedOut[i]);
+    maxError = std::max(maxError, glm::compMax(d));
+  }
+  std::cout << "  max difference padded vs vec3: " << maxError << std::endl;
+}
+
+void benchAligned() {
+  std::cout << "Aligned and padded vertex storage" << std::endl;
+  benchAlignedCount(8192, 2000);
+  benchAlignedCount(4000000, 5);
+}
+
+struct Benchmark {
+  const char *name;
+  void (*run)();
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"morton", benchMorton},
+    {"quat", benchQuat},
+    {"affine", benchAffine},
+    {"curves", benchCurves},
+    {"srgb", benchSrgb},
+    {"normalize", benchNormalize},
+    {"normals", benchNormals},
+    {"reduce", benchReduce},
+    {"decompose", benchDecompose},
+    {"aligned", benchAligned},
+};
+
+int main(int argc, char **argv) {
+  for (const Benchmark &benchmark : BENCHMARKS) {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc; ++i) {
+      selected = selected || strcmp(argv[i], benchmark.name) == 0;
+    }
+    if (selected) {
+      benchmark.run();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,299 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+
+#include "morton.h"
+#include "parallel.h"
+#include "reduce.h"
+
+const int BVH_LEAF_SIZE = 4;
+// Subtrees below this size are not worth a thread of their own.
+const int LINEAR_BVH_MIN_SUBTREE = 1 << 15;
+
+AABB emptyAABB() {
+  AABB box;
+  box.min = glm::vec2(FLT_MAX, FLT_MAX);
+  box.max = glm::vec2(-FLT_MAX, -FLT_MAX);
+  return box;
+}
+
+void expandAABB(AABB &box, glm::vec2 point) {
+  box.min = glm::min(box.min, point);
+  box.max = glm::max(box.max, point);
+}
+
+AABB mergeAABB(const AABB &a, const AABB &b) {
+  AABB box;
+  box.min = glm::min(a.min, b.min);
+  box.max = glm::max(a.max, b.max);
+  return box;
+}
+
+bool overlapsAABB(const AABB &a, const AABB &b) {
+  return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y &&
+         b.min.y <= a.max.y;
+}
+
+AABB transformAABB(const Affine2 &transform, const AABB &box) {
+  // Arvo's method: the extent along each output axis is the sum of the
+  // absolute contributions of the input extents.
+  glm::vec2 center = (box.min + box.max) * 0.5f;
+  glm::vec2 extent = (box.max - box.min) * 0.5f;
+  glm::vec2 newCenter = transformPoint(transform, center);
+  glm::vec2 newExtent =
+      glm::abs(transform.x) * extent.x + glm::abs(transform.y) * extent.y;
+
+  AABB result;
+  result.min = newCenter - newExtent;
+  result.max = newCenter + newExtent;
+  return result;
+}
+
+AABB transformAABB(const glm::mat3 &transform, const AABB &box) {
+  return transformAABB(toAffine2(transform), box);
+}
+
+void Bvh::build(const std::vector<AABB> &boxes) {
+  nodes.clear();
+  primitives.resize(boxes.size());
+  for (int i = 0; i < (int)boxes.size(); ++i) {
+    primitives[i] = i;
+  }
+  if (boxes.empty()) {
+    return;
+  }
+
+  nodes.reserve(2 * boxes.size() / BVH_LEAF_SIZE + 1);
+  nodes.push_back(BvhNode());
+  buildNode(boxes, 0, 0, boxes.size());
+}
+
+void Bvh::buildNode(const std::vector<AABB> &boxes, int index, int first,
+                    int count) {
+  AABB bounds = emptyAABB();
+  AABB centers = emptyAABB();
+  for (int i = first; i < first + count; ++i) {
+    const AABB &box = boxes[primitives[i]];
+    bounds = mergeAABB(bounds, box);
+    expandAABB(centers, (box.min + box.max) * 0.5f);
+  }
+  nodes[index].bounds = bounds;
+  nodes[index].first = first;
+
+  if (count <= BVH_LEAF_SIZE) {
+    nodes[index].left = -1;
+    nodes[index].count = count;
+    return;
+  }
+
+  // Median split along the axis where primitive centers spread the most.
+  glm::vec2 spread = centers.max - centers.min;
+  int axis = spread.x >= spread.y ? 0 : 1;
+  int half = count / 2;
+  std::nth_element(primitives.begin() + first,
+                   primitives.begin() + first + half,
+                   primitives.begin() + first + count, [&](int a, int b) {
+                     return boxes[a].min[axis] + boxes[a].max[axis] <
+                            boxes[b].min[axis] + boxes[b].max[axis];
+                   });
+
+  int left = nodes.size();
+  nodes.push_back(BvhNode());
+  nodes.push_back(BvhNode());
+  nodes[index].left = left;
+  nodes[index].count = 0;
+
+  buildNode(boxes, left, first, half);
+  buildNode(boxes, left + 1, first + half, count - half);
+}
+
+// Index one past the primitives of [first, first + count) whose code has a 0
+// at the highest bit where the range's codes differ.
+int findMortonSplit(const std::vector<uint32_t> &codes, int first, int count) {
+  uint32_t firstCode = codes[first];
+  uint32_t lastCode = codes[first + count - 1];
+  if (firstCode == lastCode) {
+    return first + count / 2;
+  }
+
+  uint32_t bit = 0x80000000u >> __builtin_clz(firstCode ^ lastCode);
+  uint32_t rightStart = (firstCode & ~(bit - 1)) | bit;
+  return std::lower_bound(codes.begin() + first,
+                          codes.begin() + first + count, rightStart) -
+         codes.begin();
+}
+
+void buildLinearNode(std::vector<BvhNode> &nodes,
+                     const std::vector<AABB> &boxes,
+                     const std::vector<int> &primitives,
+                     const std::vector<uint32_t> &codes, int index, int first,
+                     int count) {
+  nodes[index].first = first;
+  if (count <= BVH_LEAF_SIZE) {
+    AABB bounds = emptyAABB();
+    for (int i = first; i < first + count; ++i) {
+      bounds = mergeAABB(bounds, boxes[primitives[i]]);
+    }
+    nodes[index].bounds = bounds;
+    nodes[index].left = -1;
+    nodes[index].count = count;
+    return;
+  }
+
+  int split = findMortonSplit(codes, first, count);
+  int left = nodes.size();
+  nodes.push_back(BvhNode());
+  nodes.push_back(BvhNode());
+  nodes[index].left = left;
+  nodes[index].count = 0;
+
+  buildLinearNode(nodes, boxes, primitives, codes, left, first, split - first);
+  buildLinearNode(nodes, boxes, primitives, codes, left + 1, split,
+                  first + count - split);
+  nodes[index].bounds =
+      mergeAABB(nodes[left].bounds, nodes[left + 1].bounds);
+}
+
+struct LinearSubtree {
+  int stub;
+  int first;
+  int count;
+  std::vector<BvhNode> nodes;
+};
+
+// Builds the top levels of the tree in place and leaves a stub node for each
+// subtree that is built separately.
+void splitLinearTop(std::vector<BvhNode> &nodes,
+                    const std::vector<uint32_t> &codes, int index, int first,
+                    int count, int depth, std::vector<LinearSubtree> &subtrees) {
+  if (depth == 0 || count < 2 * LINEAR_BVH_MIN_SUBTREE) {
+    subtrees.push_back({index, first, count, {}});
+    return;
+  }
+
+  int split = findMortonSplit(codes, first, count);
+  int left = nodes.size();
+  nodes.push_back(BvhNode());
+  nodes.push_back(BvhNode());
+  nodes[index].left = left;
+  nodes[index].first = first;
+  nodes[index].count = 0;
+
+  splitLinearTop(nodes, codes, left, first, split - first, depth - 1,
+                 subtrees);
+  splitLinearTop(nodes, codes, left + 1, split, first + count - split,
+                 depth - 1, subtrees);
+}
+
+void Bvh::buildLinear(const std::vector<AABB> &boxes) {
+  nodes.clear();
+  int count = boxes.size();
+  primitives.resize(count);
+  for (int i = 0; i < count; ++i) {
+    primitives[i] = i;
+  }
+  if (boxes.empty()) {
+    return;
+  }
+
+  std::vector<glm::vec2> centers(count);
+  parallelFor(count, LINEAR_BVH_MIN_SUBTREE, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      centers[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+    }
+  });
+  AABB centerBounds = getBounds(centers.data(), count);
+  std::vector<uint32_t> codes(count);
+  encodeMorton2D(centers.data(), count, centerBounds, codes.data());
+  radixSortMorton(codes, primitives);
+
+  // Split the top until there is a subtree per thread, build the subtrees
+  // in parallel, then splice them in behind the top levels.
+  int depth = 0;
+  while ((1u << depth) < getParallelThreads(count, LINEAR_BVH_MIN_SUBTREE)) {
+    depth++;
+  }
+  std::vector<LinearSubtree> subtrees;
+  nodes.push_back(BvhNode());
+  splitLinearTop(nodes, codes, 0, 0, count, depth, subtrees);
+  int topCount = nodes.size();
+
+  parallelFor(subtrees.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      LinearSubtree &subtree = subtrees[i];
+      subtree.nodes.reserve(2 * subtree.count / BVH_LEAF_SIZE + 1);
+      subtree.nodes.push_back(BvhNode());
+      buildLinearNode(subtree.nodes, boxes, primitives, codes, 0,
+                      subtree.first, subtree.count);
+    }
+  });
+
+  std::vector<bool> isStub(topCount, false);
+  for (LinearSubtree &subtree : subtrees) {
+    // Local node i > 0 lands at base + i; the local root replaces the
+    // stub.
+    int base = nodes.size() - 1;
+    for (BvhNode &node : subtree.nodes) {
+      if (node.left >= 0) {
+        node.left += base;
+      }
+    }
+    nodes[subtree.stub] = subtree.nodes[0];
+    nodes.insert(nodes.end(), subtree.nodes.begin() + 1, subtree.nodes.end());
+    isStub[subtree.stub] = true;
+  }
+  for (int i = topCount - 1; i >= 0; --i) {
+    if (!isStub[i]) {
+      nodes[i].bounds =
+          mergeAABB(nodes[nodes[i].left].bounds, nodes[nodes[i].left + 1].bounds);
+    }
+  }
+}
+
+void Bvh::refit(const std::vector<AABB> &boxes) {
+  for (int i = nodes.size() - 1; i >= 0; --i) {
+    BvhNode &node = nodes[i];
+    if (node.count > 0) {
+      AABB bounds = emptyAABB();
+      for (int j = node.first; j < node.first + node.count; ++j) {
+        bounds = mergeAABB(bounds, boxes[primitives[j]]);
+      }
+      node.bounds = bounds;
+    } else {
+      node.bounds =
+          mergeAABB(nodes[node.left].bounds, nodes[node.left + 1].bounds);
+    }
+  }
+}
+
+void Bvh::query(const std::vector<AABB> &boxes, const AABB &view,
+                std::vector<int> &result) const {
+  if (nodes.empty()) {
+    return;
+  }
+
+  // Linear builds split duplicate Morton codes by median and splice
+  // subtrees under a top tree, so the depth has no small fixed bound.
+  std::vector<int> stack;
+  stack.reserve(64);
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const BvhNode &node = nodes[stack.back()];
+    stack.pop_back();
+    if (!overlapsAABB(node.bounds, view)) {
+      continue;
+    }
+    if (node.count > 0) {
+      for (int i = node.first; i < node.first + node.count; ++i) {
+        if (overlapsAABB(boxes[primitives[i]], view)) {
+          result.push_back(primitives[i]);
+        }
+      }
+    } else {
+      stack.push_back(node.left);
+      stack.push_back(node.left + 1);
+    }
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "affine.h"
+
+struct AABB {
+  glm::vec2 min;
+  glm::vec2 max;
+};
+
+AABB emptyAABB();
+void expandAABB(AABB &box, glm::vec2 point);
+AABB mergeAABB(const AABB &a, const AABB &b);
+bool overlapsAABB(const AABB &a, const AABB &b);
+AABB transformAABB(const Affine2 &transform, const AABB &box);
+AABB transformAABB(const glm::mat3 &transform, const AABB &box);
+
+// Internal nodes store their children at left and left + 1; leaves store a
+// range of primitive indices. Children are always placed after their parent,
+// so refit() can walk the array backwards.
+struct BvhNode {
+  AABB bounds;
+  int left;
+  int first;
+  int count;
+};
+
+class Bvh {
+public:
+  void build(const std::vector<AABB> &boxes);
+  // Linear BVH: sorts primitives along a Morton curve of their centers and
+  // splits each range at the highest differing code bit. Much faster to
+  // build than build() for large inputs, with somewhat looser nodes.
+  void buildLinear(const std::vector<AABB> &boxes);
+  // Recomputes node bounds after primitive boxes moved, keeping the topology.
+  void refit(const std::vector<AABB> &boxes);
+  // Appends the indices of primitives overlapping view, in no fixed order.
+  void query(const std::vector<AABB> &boxes, const AABB &view,
+             std::vector<int> &result) const;
+
+  const std::vector<BvhNode> &getNodes() const { return nodes; }
+  const std::vector<int> &getPrimitives() const { return primitives; }
+
+private:
+  void buildNode(const std::vector<AABB> &boxes, int index, int first,
+                 int count);
+
+  std::vector<BvhNode> nodes;
+  std::vector<int> primitives;
+};
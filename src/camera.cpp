@@ -0,0 +1,55 @@
+#include "camera.h"
+
+#include <glm/ext/matrix_clip_space.hpp>
+
+const double CAMERA_MIN_ZOOM = 1e-3;
+const double CAMERA_MAX_ZOOM = 1e6;
+
+void Camera2D::setViewport(int width, int height) {
+  if (width > 0 && height > 0) {
+    this->width = width;
+    this->height = height;
+  }
+}
+
+void Camera2D::pan(glm::vec2 screenDelta) {
+  glm::vec2 halfExtent = getHalfExtent();
+  center -= glm::vec2(screenDelta.x, -screenDelta.y) * 2.0f * halfExtent;
+}
+
+void Camera2D::zoomAt(double factor, glm::vec2 screenPosition) {
+  // Keep the world point under the cursor fixed while zooming.
+  glm::vec2 anchor = screenToWorld(screenPosition);
+  zoom = glm::clamp(zoom * factor, CAMERA_MIN_ZOOM, CAMERA_MAX_ZOOM);
+  center += anchor - screenToWorld(screenPosition);
+}
+
+glm::mat4 Camera2D::getViewProjection() const {
+  glm::vec2 halfExtent = getHalfExtent();
+  return glm::ortho(center.x - halfExtent.x, center.x + halfExtent.x,
+                    center.y - halfExtent.y, center.y + halfExtent.y);
+}
+
+AABB Camera2D::getVisibleBounds() const {
+  glm::vec2 halfExtent = getHalfExtent();
+  AABB bounds;
+  bounds.min = center - halfExtent;
+  bounds.max = center + halfExtent;
+  return bounds;
+}
+
+glm::vec2 Camera2D::getPixelSize() const {
+  return 2.0f * getHalfExtent() / glm::vec2(width, height);
+}
+
+glm::vec2 Camera2D::screenToWorld(glm::vec2 screenPosition) const {
+  glm::vec2 ndc(screenPosition.x * 2.0 - 1.0, 1.0 - screenPosition.y * 2.0);
+  return center + ndc * getHalfExtent();
+}
+
+glm::vec2 Camera2D::getHalfExtent() const {
+  double aspect = (double)width / height;
+  glm::vec2 halfExtent = (aspect >= 1.0) ? glm::vec2(aspect, 1.0)
+                                         : glm::vec2(1.0, 1.0 / aspect);
+  return halfExtent / (float)zoom;
+}
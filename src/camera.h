@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+
+const unsigned int CAMERA_BUFFER_BINDING = 0;
+
+// Uniform block read by the task2 vertex shaders. Layout matches std140.
+struct CameraData {
+  glm::mat4 viewProjection;
+};
+
+// Orthographic 2D camera. At zoom 1 the [-1, 1] square fits the viewport
+// along its shorter side, so shapes keep their aspect ratio. Screen positions
+// are given as fractions of the window, with (0, 0) at the top left.
+class Camera2D {
+public:
+  void setViewport(int width, int height);
+  void pan(glm::vec2 screenDelta);
+  void zoomAt(double factor, glm::vec2 screenPosition);
+
+  glm::mat4 getViewProjection() const;
+  AABB getVisibleBounds() const;
+  // World-space size of one framebuffer pixel.
+  glm::vec2 getPixelSize() const;
+  glm::vec2 getViewportSize() const { return glm::vec2(width, height); }
+  glm::vec2 screenToWorld(glm::vec2 screenPosition) const;
+
+private:
+  glm::vec2 getHalfExtent() const;
+
+  glm::vec2 center = glm::vec2(0.0, 0.0);
+  double zoom = 1.0;
+  int width = 500;
+  int height = 500;
+};
@@ -0,0 +1,146 @@
+#include "color_space.h"
+
+#include <cmath>
+
+#include "parallel.h"
+#include "simd.h"
+
+const size_t COLOR_MIN_PER_THREAD = 1 << 16;
+
+// Below this the curve is the linear segment 12.92 x.
+const float SRGB_LINEAR_LIMIT = 0.0031308f;
+
+// (p0 + p1 s + p2 s^2 + p3 s^3) / (1 + q1 s + q2 s^2 + q3 s^3) with
+// s = sqrt(x) fits 1.055 x^(1 / 2.4) - 0.055 to 4.2e-6 on
+// [SRGB_LINEAR_LIMIT, 1]. Fitted by iteratively reweighted least squares.
+const float SRGB_P[4] = {-0.0490137575f, 1.16734532f, 18.1655925f,
+                         18.4982892f};
+const float SRGB_Q[4] = {1.0f, 14.7008241f, 21.1632592f, 0.918192240f};
+
+float linearToSrgbScalar(float x) {
+  x = std::fmin(std::fmax(x, 0.0f), 1.0f);
+  if (x <= SRGB_LINEAR_LIMIT) {
+    return 12.92f * x;
+  }
+  float s = std::sqrt(x);
+  float p = ((SRGB_P[3] * s + SRGB_P[2]) * s + SRGB_P[1]) * s + SRGB_P[0];
+  float q = ((SRGB_Q[3] * s + SRGB_Q[2]) * s + SRGB_Q[1]) * s + SRGB_Q[0];
+  return p / q;
+}
+
+struct SrgbTable {
+  float values[256];
+
+  SrgbTable() {
+    for (int i = 0; i < 256; ++i) {
+      double c = i / 255.0;
+      values[i] = (float)(c <= 0.04045 ? c / 12.92
+                                       : std::pow((c + 0.055) / 1.055, 2.4));
+    }
+  }
+};
+
+const SrgbTable &getSrgbTable() {
+  static const SrgbTable table;
+  return table;
+}
+
+#ifdef SIMD_X86
+SIMD_AVX2 size_t srgb8ToLinearAvx2(const float table[], const uint8_t in[],
+                                   float out[], size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i index =
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(in + i)));
+    _mm256_storeu_ps(out + i, _mm256_i32gather_ps(table, index, 4));
+  }
+  return i;
+}
+
+SIMD_AVX2 __m256 linearToSrgbLanes(__m256 x) {
+  x = _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()),
+                    _mm256_set1_ps(1.0f));
+  __m256 s = _mm256_sqrt_ps(x);
+  __m256 p = _mm256_set1_ps(SRGB_P[3]), q = _mm256_set1_ps(SRGB_Q[3]);
+  for (int i = 2; i >= 0; --i) {
+    p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(SRGB_P[i]));
+    q = _mm256_fmadd_ps(q, s, _mm256_set1_ps(SRGB_Q[i]));
+  }
+  __m256 curve = _mm256_div_ps(p, q);
+  __m256 line = _mm256_mul_ps(x, _mm256_set1_ps(12.92f));
+  __m256 low =
+      _mm256_cmp_ps(x, _mm256_set1_ps(SRGB_LINEAR_LIMIT), _CMP_LE_OQ);
+  return _mm256_blendv_ps(curve, line, low);
+}
+
+SIMD_AVX2 size_t linearToSrgbAvx2(const float in[], float out[], size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(out + i, linearToSrgbLanes(_mm256_loadu_ps(in + i)));
+  }
+  return i;
+}
+
+SIMD_AVX2 size_t linearToSrgb8Avx2(const float in[], uint8_t out[],
+                                   size_t count) {
+  __m256 scale = _mm256_set1_ps(255.0f), half = _mm256_set1_ps(0.5f);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i a = _mm256_cvttps_epi32(_mm256_fmadd_ps(
+        linearToSrgbLanes(_mm256_loadu_ps(in + i)), scale, half));
+    __m256i b = _mm256_cvttps_epi32(_mm256_fmadd_ps(
+        linearToSrgbLanes(_mm256_loadu_ps(in + i + 8)), scale, half));
+    // The packs work per 128-bit half, so the 16-bit results are put back
+    // in order before narrowing to bytes.
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b),
+                                             _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words),
+                                     _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128((__m128i *)(out + i), bytes);
+  }
+  return i;
+}
+#endif
+
+void srgb8ToLinear(const uint8_t in[], float out[], size_t count) {
+  const float *table = getSrgbTable().values;
+  parallelFor(count, COLOR_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      i += srgb8ToLinearAvx2(table, in + begin, out + begin, end - begin);
+    }
+#endif
+    for (; i < end; ++i) {
+      out[i] = table[in[i]];
+    }
+  });
+}
+
+void linearToSrgb(const float in[], float out[], size_t count) {
+  parallelFor(count, COLOR_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      i += linearToSrgbAvx2(in + begin, out + begin, end - begin);
+    }
+#endif
+    for (; i < end; ++i) {
+      out[i] = linearToSrgbScalar(in[i]);
+    }
+  });
+}
+
+void linearToSrgb8(const float in[], uint8_t out[], size_t count) {
+  parallelFor(count, COLOR_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      i += linearToSrgb8Avx2(in + begin, out + begin, end - begin);
+    }
+#endif
+    for (; i < end; ++i) {
+      out[i] = (uint8_t)(linearToSrgbScalar(in[i]) * 255.0f + 0.5f);
+    }
+  });
+}
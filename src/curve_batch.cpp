@@ -0,0 +1,304 @@
+#include "curve_batch.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/easing.hpp>
+#include <algorithm>
+
+#include "parallel.h"
+#include "simd.h"
+
+const size_t CURVE_MIN_PER_THREAD = 1 << 15;
+// Curves built together, so their control values stay in cache while every
+// segment row is written.
+const size_t CURVE_BUILD_BLOCK = 256;
+
+const char *EASE_NAMES[EASE_TYPE_COUNT] = {
+    "linear",    "quadraticIn",    "quadraticOut", "quadraticInOut",
+    "cubicIn",   "cubicOut",       "cubicInOut",   "sineIn",
+    "sineOut",   "sineInOut",      "exponentialOut", "elasticOut",
+    "backOut",   "bounceOut"};
+
+const char *getEaseName(EaseType type) { return EASE_NAMES[type]; }
+
+float evaluateEaseScalar(EaseType type, float t) {
+  switch (type) {
+  case EASE_LINEAR:
+    return glm::linearInterpolation(t);
+  case EASE_QUADRATIC_IN:
+    return glm::quadraticEaseIn(t);
+  case EASE_QUADRATIC_OUT:
+    return glm::quadraticEaseOut(t);
+  case EASE_QUADRATIC_IN_OUT:
+    return glm::quadraticEaseInOut(t);
+  case EASE_CUBIC_IN:
+    return glm::cubicEaseIn(t);
+  case EASE_CUBIC_OUT:
+    return glm::cubicEaseOut(t);
+  case EASE_CUBIC_IN_OUT:
+    return glm::cubicEaseInOut(t);
+  case EASE_SINE_IN:
+    return glm::sineEaseIn(t);
+  case EASE_SINE_OUT:
+    return glm::sineEaseOut(t);
+  case EASE_SINE_IN_OUT:
+    return glm::sineEaseInOut(t);
+  case EASE_EXPONENTIAL_OUT:
+    return glm::exponentialEaseOut(t);
+  case EASE_ELASTIC_OUT:
+    return glm::elasticEaseOut(t);
+  case EASE_BACK_OUT:
+    return glm::backEaseOut(t);
+  case EASE_BOUNCE_OUT:
+  default:
+    return glm::bounceEaseOut(t);
+  }
+}
+
+#ifdef SIMD_X86
+SIMD_AVX2 __m256 splat(float value) { return _mm256_set1_ps(value); }
+
+SIMD_AVX2 __m256 polynomialLanes(__m256 x, const float c[], int degree) {
+  __m256 p = splat(c[degree]);
+  for (int i = degree - 1; i >= 0; --i) {
+    p = _mm256_fmadd_ps(p, x, splat(c[i]));
+  }
+  return p;
+}
+
+// sin(x) for |x| up to a few hundred: x is reduced by the nearest multiple
+// of pi, in two parts so the reduction stays exact, and the remainder in
+// [-pi/2, pi/2] goes through the Taylor series up to x^11.
+SIMD_AVX2 __m256 sinLanes(__m256 x) {
+  static const float SIN_COEFFICIENTS[6] = {
+      1.0f,           -1.0f / 6.0f,        1.0f / 120.0f,
+      -1.0f / 5040.0f, 1.0f / 362880.0f, -1.0f / 39916800.0f};
+  __m256 k = _mm256_round_ps(_mm256_mul_ps(x, splat(1.0f / glm::pi<float>())),
+                             _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 r = _mm256_fnmadd_ps(k, splat(3.14159274f), x);
+  r = _mm256_fnmadd_ps(k, splat(-8.74227766e-8f), r);
+  __m256 p = polynomialLanes(_mm256_mul_ps(r, r), SIN_COEFFICIENTS, 5);
+  __m256i odd = _mm256_slli_epi32(_mm256_cvtps_epi32(k), 31);
+  return _mm256_xor_ps(_mm256_mul_ps(p, r), _mm256_castsi256_ps(odd));
+}
+
+// 2^x for x in [-126, 126]: the integer part goes into the exponent and the
+// fraction in [-0.5, 0.5] through the Taylor series of 2^f up to f^6.
+SIMD_AVX2 __m256 exp2Lanes(__m256 x) {
+  static const float EXP2_COEFFICIENTS[7] = {
+      1.0f,          0.693147181f,  0.240226507f, 0.0555041087f,
+      0.00961812911f, 0.00133335581f, 0.000154035304f};
+  x = _mm256_max_ps(_mm256_min_ps(x, splat(126.0f)), splat(-126.0f));
+  __m256 i = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 p = polynomialLanes(_mm256_sub_ps(x, i), EXP2_COEFFICIENTS, 6);
+  __m256i exponent = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(i), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(p, _mm256_castsi256_ps(exponent));
+}
+
+// Picks a where t < edge and b elsewhere.
+SIMD_AVX2 __m256 selectBelow(__m256 t, float edge, __m256 a, __m256 b) {
+  return _mm256_blendv_ps(b, a, _mm256_cmp_ps(t, splat(edge), _CMP_LT_OQ));
+}
+
+SIMD_AVX2 __m256 quadraticLanes(__m256 t, float a, float b, float c) {
+  return _mm256_fmadd_ps(_mm256_fmadd_ps(splat(a), t, splat(b)), t, splat(c));
+}
+
+SIMD_AVX2 __m256 evaluateEaseLanes(EaseType type, __m256 t) {
+  const __m256 one = splat(1.0f);
+  switch (type) {
+  case EASE_LINEAR:
+    return t;
+  case EASE_QUADRATIC_IN:
+    return _mm256_mul_ps(t, t);
+  case EASE_QUADRATIC_OUT:
+    return _mm256_mul_ps(t, _mm256_sub_ps(splat(2.0f), t));
+  case EASE_QUADRATIC_IN_OUT:
+    return selectBelow(t, 0.5f, _mm256_mul_ps(splat(2.0f), _mm256_mul_ps(t, t)),
+                       quadraticLanes(t, -2.0f, 4.0f, -1.0f));
+  case EASE_CUBIC_IN:
+    return _mm256_mul_ps(t, _mm256_mul_ps(t, t));
+  case EASE_CUBIC_OUT: {
+    __m256 f = _mm256_sub_ps(t, one);
+    return _mm256_fmadd_ps(_mm256_mul_ps(f, f), f, one);
+  }
+  case EASE_CUBIC_IN_OUT: {
+    __m256 in =
+        _mm256_mul_ps(splat(4.0f), _mm256_mul_ps(t, _mm256_mul_ps(t, t)));
+    __m256 f = _mm256_fmsub_ps(splat(2.0f), t, splat(2.0f));
+    __m256 out = _mm256_fmadd_ps(
+        splat(0.5f), _mm256_mul_ps(_mm256_mul_ps(f, f), f), one);
+    return selectBelow(t, 0.5f, in, out);
+  }
+  case EASE_SINE_IN:
+    return _mm256_add_ps(
+        sinLanes(_mm256_mul_ps(_mm256_sub_ps(t, one),
+                               splat(glm::half_pi<float>()))),
+        one);
+  case EASE_SINE_OUT:
+    return sinLanes(_mm256_mul_ps(t, splat(glm::half_pi<float>())));
+  case EASE_SINE_IN_OUT: {
+    // cos(t * pi) = sin(pi / 2 - t * pi)
+    __m256 c = sinLanes(_mm256_fnmadd_ps(t, splat(glm::pi<float>()),
+                                         splat(glm::half_pi<float>())));
+    return _mm256_mul_ps(splat(0.5f), _mm256_sub_ps(one, c));
+  }
+  case EASE_EXPONENTIAL_OUT: {
+    __m256 e = _mm256_sub_ps(one, exp2Lanes(_mm256_mul_ps(splat(-10.0f), t)));
+    return _mm256_blendv_ps(e, t, _mm256_cmp_ps(t, one, _CMP_GE_OQ));
+  }
+  case EASE_ELASTIC_OUT: {
+    __m256 s = sinLanes(_mm256_mul_ps(splat(-13.0f * glm::half_pi<float>()),
+                                      _mm256_add_ps(t, one)));
+    return _mm256_fmadd_ps(s, exp2Lanes(_mm256_mul_ps(splat(-10.0f), t)), one);
+  }
+  case EASE_BACK_OUT: {
+    const float o = 1.70158f;
+    __m256 n = _mm256_sub_ps(t, one);
+    __m256 z = _mm256_fmadd_ps(splat(o + 1.0f), n, splat(o));
+    return _mm256_fmadd_ps(_mm256_mul_ps(n, n), z, one);
+  }
+  case EASE_BOUNCE_OUT:
+  default: {
+    __m256 result = quadraticLanes(t, 54.0f / 5.0f, -513.0f / 25.0f,
+                                   268.0f / 25.0f);
+    result = selectBelow(t, 9.0f / 10.0f,
+                         quadraticLanes(t, 4356.0f / 361.0f,
+                                        -35442.0f / 1805.0f,
+                                        16061.0f / 1805.0f),
+                         result);
+    result = selectBelow(
+        t, 8.0f / 11.0f,
+        quadraticLanes(t, 363.0f / 40.0f, -99.0f / 10.0f, 17.0f / 5.0f),
+        result);
+    __m256 first = _mm256_mul_ps(splat(121.0f / 16.0f), _mm256_mul_ps(t, t));
+    return selectBelow(t, 4.0f / 11.0f, first, result);
+  }
+  }
+}
+
+SIMD_AVX2 size_t evaluateEasingAvx2(EaseType type, const float t[], float out[],
+                                    size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(out + i, evaluateEaseLanes(type, _mm256_loadu_ps(t + i)));
+  }
+  return i;
+}
+
+SIMD_AVX2 size_t evaluateCurvesAvx2(const CubicCurves &curves, const float t[],
+                                    float out[], size_t begin, size_t end) {
+  const float *base = &curves.coefficients[0].x;
+  __m256 segments = splat((float)curves.segmentCount);
+  __m256 lastSegment = splat((float)(curves.segmentCount - 1));
+  __m256i segmentStride = _mm256_set1_epi32(curves.curveCount * 4);
+  __m256i curveIndex = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                       _mm256_set1_epi32((int)begin)),
+      2);
+  __m256i step = _mm256_set1_epi32(8 * 4);
+
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 ti = _mm256_loadu_ps(t + i);
+    ti = _mm256_max_ps(_mm256_min_ps(ti, splat(1.0f)), _mm256_setzero_ps());
+    __m256 x = _mm256_mul_ps(ti, segments);
+    __m256 segment = _mm256_min_ps(_mm256_floor_ps(x), lastSegment);
+    __m256 u = _mm256_sub_ps(x, segment);
+    __m256i index = _mm256_add_epi32(
+        curveIndex,
+        _mm256_mullo_epi32(_mm256_cvttps_epi32(segment), segmentStride));
+    __m256 a = _mm256_i32gather_ps(base, index, 4);
+    __m256 b = _mm256_i32gather_ps(base + 1, index, 4);
+    __m256 c = _mm256_i32gather_ps(base + 2, index, 4);
+    __m256 d = _mm256_i32gather_ps(base + 3, index, 4);
+    __m256 value = _mm256_fmadd_ps(_mm256_fmadd_ps(a, u, b), u, c);
+    _mm256_storeu_ps(out + i, _mm256_fmadd_ps(value, u, d));
+    curveIndex = _mm256_add_epi32(curveIndex, step);
+  }
+  return i;
+}
+#endif
+
+void evaluateEasing(EaseType type, const float t[], float out[],
+                    size_t count) {
+  parallelFor(count, CURVE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      i += evaluateEasingAvx2(type, t + begin, out + begin, end - begin);
+    }
+#endif
+    for (; i < end; ++i) {
+      out[i] = evaluateEaseScalar(type, t[i]);
+    }
+  });
+}
+
+// Builds each segment from its four control values; getSegment returns
+// the (a, b, c, d) coefficients for segment s of curve c.
+template <typename F>
+void buildCurves(int curveCount, int pointsPerCurve, CubicCurves &curves,
+                 const F &getSegment) {
+  curves.curveCount = curveCount;
+  curves.segmentCount = std::max(1, pointsPerCurve - 1);
+  curves.coefficients.resize((size_t)curveCount * curves.segmentCount);
+  parallelFor(curveCount, CURVE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    for (size_t block = begin; block < end; block += CURVE_BUILD_BLOCK) {
+      size_t blockEnd = std::min(end, block + CURVE_BUILD_BLOCK);
+      for (int s = 0; s < curves.segmentCount; ++s) {
+        glm::vec4 *segment = &curves.coefficients[(size_t)s * curveCount];
+        for (size_t c = block; c < blockEnd; ++c) {
+          segment[c] = getSegment(c, s);
+        }
+      }
+    }
+  });
+}
+
+void buildCatmullRomCurves(const float points[], int curveCount,
+                           int pointsPerCurve, CubicCurves &curves) {
+  int last = pointsPerCurve - 1;
+  buildCurves(curveCount, pointsPerCurve, curves, [&](size_t c, int s) {
+    const float *p = points + c * pointsPerCurve;
+    float v1 = p[std::max(s - 1, 0)], v2 = p[s];
+    float v3 = p[std::min(s + 1, last)], v4 = p[std::min(s + 2, last)];
+    return glm::vec4(0.5f * (-v1 + 3.0f * v2 - 3.0f * v3 + v4),
+                     0.5f * (2.0f * v1 - 5.0f * v2 + 4.0f * v3 - v4),
+                     0.5f * (v3 - v1), v2);
+  });
+}
+
+void buildHermiteCurves(const float points[], const float tangents[],
+                        int curveCount, int pointsPerCurve,
+                        CubicCurves &curves) {
+  int last = pointsPerCurve - 1;
+  buildCurves(curveCount, pointsPerCurve, curves, [&](size_t c, int s) {
+    const float *p = points + c * pointsPerCurve;
+    const float *m = tangents + c * pointsPerCurve;
+    float v1 = p[s], v2 = p[std::min(s + 1, last)];
+    float t1 = m[s], t2 = m[std::min(s + 1, last)];
+    return glm::vec4(2.0f * v1 - 2.0f * v2 + t1 + t2,
+                     -3.0f * v1 + 3.0f * v2 - 2.0f * t1 - t2, t1, v1);
+  });
+}
+
+void evaluateCurves(const CubicCurves &curves, const float t[], float out[]) {
+  parallelFor(curves.curveCount, CURVE_MIN_PER_THREAD,
+              [&](size_t begin, size_t end) {
+                size_t i = begin;
+#ifdef SIMD_X86
+                if (cpuHasAvx2()) {
+                  i = evaluateCurvesAvx2(curves, t, out, begin, end);
+                }
+#endif
+                for (; i < end; ++i) {
+                  float x = glm::clamp(t[i], 0.0f, 1.0f) * curves.segmentCount;
+                  int s = std::min((int)x, curves.segmentCount - 1);
+                  float u = x - s;
+                  const glm::vec4 &k =
+                      curves.coefficients[(size_t)s * curves.curveCount + i];
+                  out[i] = ((k.x * u + k.y) * u + k.z) * u + k.w;
+                }
+              });
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+// The easing curves of glm/gtx/easing.hpp that batches support.
+enum EaseType {
+  EASE_LINEAR,
+  EASE_QUADRATIC_IN,
+  EASE_QUADRATIC_OUT,
+  EASE_QUADRATIC_IN_OUT,
+  EASE_CUBIC_IN,
+  EASE_CUBIC_OUT,
+  EASE_CUBIC_IN_OUT,
+  EASE_SINE_IN,
+  EASE_SINE_OUT,
+  EASE_SINE_IN_OUT,
+  EASE_EXPONENTIAL_OUT,
+  EASE_ELASTIC_OUT,
+  EASE_BACK_OUT,
+  EASE_BOUNCE_OUT,
+  EASE_TYPE_COUNT
+};
+
+const char *getEaseName(EaseType type);
+
+// out[i] = ease(t[i]) for t in [0, 1], eight values per AVX2 iteration and
+// split across threads. sin and exp2 use polynomial approximations; all
+// curves agree with glm to within 2e-6. out may alias t.
+void evaluateEasing(EaseType type, const float t[], float out[], size_t count);
+
+// Piecewise cubic curves over t in [0, 1], each split into segmentCount
+// equal segments. Segment s of curve c is ((a * u + b) * u + c) * u + d,
+// with u the position inside the segment, stored as the vec4 (a, b, c, d)
+// at coefficients[s * curveCount + c]. Segments are outermost so curves
+// driven by similar times read neighbouring memory.
+struct CubicCurves {
+  int curveCount = 0;
+  int segmentCount = 0;
+  std::vector<glm::vec4> coefficients;
+};
+
+// Catmull-Rom curves through pointsPerCurve values each, stored curve after
+// curve, matching glm::catmullRom on each segment. The end segments repeat
+// the first and last value as their outer control points.
+void buildCatmullRomCurves(const float points[], int curveCount,
+                           int pointsPerCurve, CubicCurves &curves);
+
+// Hermite curves with a tangent per value, matching glm::hermite.
+void buildHermiteCurves(const float points[], const float tangents[],
+                        int curveCount, int pointsPerCurve,
+                        CubicCurves &curves);
+
+// out[c] = curve c at t[c], with t clamped to [0, 1]. Eight curves per AVX2
+// iteration, split across threads; the gathers use 32-bit offsets, so
+// curveCount * segmentCount must stay below 2^29.
+void evaluateCurves(const CubicCurves &curves, const float t[], float out[]);
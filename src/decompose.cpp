@@ -0,0 +1,417 @@
+#define GLM_ENABLE_EXPERIMENTAL
+#include "decompose.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <vector>
+
+#include "parallel.h"
+#include "simd.h"
+
+const size_t DECOMPOSE_MIN_PER_THREAD = 1 << 13;
+
+// The polar iteration converges quadratically; it stops once the squared
+// change of every matrix in a batch drops below POLAR_TOLERANCE.
+const int POLAR_MAX_ITERATIONS = 20;
+const float POLAR_TOLERANCE = 1e-10f;
+
+// Rotation of the orthonormal columns c, choosing the same formula as
+// glm::decompose so both give the same sign.
+glm::quat getColumnsRotation(const glm::vec3 c[3]) {
+  float trace = c[0].x + c[1].y + c[2].z;
+  if (trace > 0.0f) {
+    float root = std::sqrt(trace + 1.0f), s = 0.5f / root;
+    return glm::quat(0.5f * root, s * (c[1].z - c[2].y),
+                     s * (c[2].x - c[0].z), s * (c[0].y - c[1].x));
+  }
+  int i = c[1].y > c[0].x ? 1 : 0;
+  i = c[2].z > c[i][i] ? 2 : i;
+  int j = (i + 1) % 3, k = (i + 2) % 3;
+  float root = std::sqrt(c[i][i] - c[j][j] - c[k][k] + 1.0f);
+  float s = 0.5f / root;
+  glm::quat q;
+  q[i] = 0.5f * root;
+  q[j] = s * (c[i][j] + c[j][i]);
+  q[k] = s * (c[i][k] + c[k][i]);
+  q.w = s * (c[j][k] - c[k][j]);
+  return q;
+}
+
+bool decomposeScalar(const glm::mat4 &m, TransformParts &parts) {
+  glm::vec4 perspective;
+  if (glm::decompose(m, parts.scale, parts.rotation, parts.translation,
+                     parts.skew, perspective)) {
+    return true;
+  }
+  parts.translation = glm::vec3(m[3]);
+  parts.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  parts.scale = glm::vec3(0.0f);
+  parts.skew = glm::vec3(0.0f);
+  return false;
+}
+
+void decomposeTrsScalar(const glm::mat4 &m, TransformParts &parts) {
+  glm::vec3 c[3];
+  for (int i = 0; i < 3; ++i) {
+    parts.scale[i] = glm::length(glm::vec3(m[i]));
+    c[i] = glm::vec3(m[i]) / parts.scale[i];
+  }
+  if (glm::dot(c[0], glm::cross(c[1], c[2])) < 0.0f) {
+    parts.scale = -parts.scale;
+    for (glm::vec3 &column : c) {
+      column = -column;
+    }
+  }
+  parts.translation = glm::vec3(m[3]);
+  parts.rotation = getColumnsRotation(c);
+  parts.skew = glm::vec3(0.0f);
+}
+
+float getSquaredNorm(const glm::mat3 &m) {
+  return glm::dot(m[0], m[0]) + glm::dot(m[1], m[1]) + glm::dot(m[2], m[2]);
+}
+
+void polarDecomposeScalar(const glm::mat3 &m, glm::quat &rotation,
+                          glm::mat3 &stretch) {
+  glm::mat3 x = glm::determinant(m) < 0.0f ? -m : m;
+  for (int iteration = 0; iteration < POLAR_MAX_ITERATIONS; ++iteration) {
+    // The columns of inverse(transpose(x)) times det.
+    glm::mat3 y(glm::cross(x[1], x[2]), glm::cross(x[2], x[0]),
+                glm::cross(x[0], x[1]));
+    float det = glm::dot(x[0], y[0]);
+    // Frobenius norm scaling: gamma^2 = |inverse(x)| / |x|.
+    float ratio = getSquaredNorm(y) / (det * det * getSquaredNorm(x));
+    float gamma = std::sqrt(std::sqrt(ratio));
+    glm::mat3 next = (x * gamma + y * (1.0f / (gamma * det))) * 0.5f;
+    float change = getSquaredNorm(next - x);
+    x = next;
+    if (change < POLAR_TOLERANCE) {
+      break;
+    }
+  }
+  glm::vec3 columns[3] = {x[0], x[1], x[2]};
+  rotation = getColumnsRotation(columns);
+  stretch = glm::transpose(x) * m;
+  stretch = (stretch + glm::transpose(stretch)) * 0.5f;
+}
+
+#ifdef SIMD_X86
+// a -= b * k
+SIMD_AVX2 void subtractLanes(__m256 a[3], const __m256 b[3], __m256 k) {
+  for (int r = 0; r < 3; ++r) {
+    a[r] = _mm256_fnmadd_ps(b[r], k, a[r]);
+  }
+}
+
+// Scales a to unit length and returns the old length.
+SIMD_AVX2 __m256 normalizeLanes(__m256 a[3]) {
+  __m256 length = _mm256_sqrt_ps(dotLanes(a, a));
+  __m256 scale = _mm256_div_ps(_mm256_set1_ps(1.0f), length);
+  for (int r = 0; r < 3; ++r) {
+    a[r] = _mm256_mul_ps(a[r], scale);
+  }
+  return length;
+}
+
+SIMD_AVX2 __m256 select(__m256 a, __m256 b, __m256 mask) {
+  return _mm256_blendv_ps(a, b, mask);
+}
+
+// getColumnsRotation on eight sets of orthonormal columns c[column][row].
+// q receives x, y, z and w.
+SIMD_AVX2 void getColumnsRotationLanes(const __m256 c[3][3], __m256 q[4]) {
+  __m256 one = _mm256_set1_ps(1.0f);
+  __m256 trace = _mm256_add_ps(_mm256_add_ps(c[0][0], c[1][1]), c[2][2]);
+  __m256 useW = _mm256_cmp_ps(trace, _mm256_setzero_ps(), _CMP_GT_OQ);
+  // Otherwise the largest diagonal entry picks x, y or z; ties keep the
+  // earlier axis, as in glm.
+  __m256 greaterY = _mm256_cmp_ps(c[1][1], c[0][0], _CMP_GT_OQ);
+  __m256 pickZ =
+      _mm256_cmp_ps(c[2][2], select(c[0][0], c[1][1], greaterY), _CMP_GT_OQ);
+  __m256 pickY = _mm256_andnot_ps(pickZ, greaterY);
+  __m256 pickX = _mm256_andnot_ps(_mm256_or_ps(pickY, pickZ),
+                                  _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+  pickX = _mm256_andnot_ps(useW, pickX);
+  pickY = _mm256_andnot_ps(useW, pickY);
+  pickZ = _mm256_andnot_ps(useW, pickZ);
+
+  // 1 + the diagonal with the signs of the chosen formula.
+  __m256 minus = _mm256_set1_ps(-1.0f);
+  __m256 signX = select(one, minus, _mm256_or_ps(pickY, pickZ));
+  __m256 signY = select(one, minus, _mm256_or_ps(pickX, pickZ));
+  __m256 signZ = select(one, minus, _mm256_or_ps(pickX, pickY));
+  __m256 t = _mm256_fmadd_ps(
+      signZ, c[2][2],
+      _mm256_fmadd_ps(signY, c[1][1], _mm256_fmadd_ps(signX, c[0][0], one)));
+  __m256 root = _mm256_sqrt_ps(t);
+  __m256 half = _mm256_mul_ps(root, _mm256_set1_ps(0.5f));
+  __m256 s = _mm256_div_ps(_mm256_set1_ps(0.5f), root);
+
+  __m256 dx = _mm256_mul_ps(s, _mm256_sub_ps(c[1][2], c[2][1]));
+  __m256 dy = _mm256_mul_ps(s, _mm256_sub_ps(c[2][0], c[0][2]));
+  __m256 dz = _mm256_mul_ps(s, _mm256_sub_ps(c[0][1], c[1][0]));
+  __m256 sxy = _mm256_mul_ps(s, _mm256_add_ps(c[0][1], c[1][0]));
+  __m256 sxz = _mm256_mul_ps(s, _mm256_add_ps(c[0][2], c[2][0]));
+  __m256 syz = _mm256_mul_ps(s, _mm256_add_ps(c[1][2], c[2][1]));
+  q[0] = select(select(select(dx, half, pickX), sxy, pickY), sxz, pickZ);
+  q[1] = select(select(select(dy, sxy, pickX), half, pickY), syz, pickZ);
+  q[2] = select(select(select(dz, sxz, pickX), syz, pickY), half, pickZ);
+  q[3] = select(select(select(half, dx, pickX), dy, pickY), dz, pickZ);
+}
+
+// Gathers float index of the eight matrices starting at base + offsets.
+SIMD_AVX2 __m256 gatherLanes(const float *base, __m256i offsets, int index) {
+  return _mm256_i32gather_ps(base + index, offsets, 4);
+}
+
+// Decomposes eight affine matrices as glm::decompose does, or without the
+// Gram-Schmidt steps when trs is set. Returns false, leaving out untouched,
+// if a matrix has perspective or is close to singular.
+SIMD_AVX2 bool decomposeLanes(const glm::mat4 m[], bool trs,
+                              TransformParts out[]) {
+  const float *base = &m[0][0][0];
+  __m256i offsets = _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112);
+  __m256 c[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int r = 0; r < 3; ++r) {
+      c[i][r] = gatherLanes(base, offsets, i * 4 + r);
+    }
+  }
+  if (!trs) {
+    __m256 bottom = _mm256_or_ps(
+        _mm256_or_ps(_mm256_cmp_ps(gatherLanes(base, offsets, 3),
+                                   _mm256_setzero_ps(), _CMP_NEQ_UQ),
+                     _mm256_cmp_ps(gatherLanes(base, offsets, 7),
+                                   _mm256_setzero_ps(), _CMP_NEQ_UQ)),
+        _mm256_or_ps(_mm256_cmp_ps(gatherLanes(base, offsets, 11),
+                                   _mm256_setzero_ps(), _CMP_NEQ_UQ),
+                     _mm256_cmp_ps(gatherLanes(base, offsets, 15),
+                                   _mm256_set1_ps(1.0f), _CMP_NEQ_UQ)));
+    __m256 cross[3];
+    crossLanes(c[1], c[2], cross);
+    __m256 det = dotLanes(c[0], cross);
+    __m256 absDet = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), det);
+    __m256 singular =
+        _mm256_cmp_ps(absDet, _mm256_set1_ps(FLT_EPSILON), _CMP_NGE_UQ);
+    if (_mm256_movemask_ps(_mm256_or_ps(bottom, singular))) {
+      return false;
+    }
+  }
+
+  __m256 scale[3], skew[3];
+  scale[0] = normalizeLanes(c[0]);
+  if (trs) {
+    scale[1] = normalizeLanes(c[1]);
+    scale[2] = normalizeLanes(c[2]);
+    skew[0] = skew[1] = skew[2] = _mm256_setzero_ps();
+  } else {
+    skew[2] = dotLanes(c[0], c[1]);
+    subtractLanes(c[1], c[0], skew[2]);
+    scale[1] = normalizeLanes(c[1]);
+    skew[2] = _mm256_div_ps(skew[2], scale[1]);
+    skew[1] = dotLanes(c[0], c[2]);
+    subtractLanes(c[2], c[0], skew[1]);
+    skew[0] = dotLanes(c[1], c[2]);
+    subtractLanes(c[2], c[1], skew[0]);
+    scale[2] = normalizeLanes(c[2]);
+    skew[1] = _mm256_div_ps(skew[1], scale[2]);
+    skew[0] = _mm256_div_ps(skew[0], scale[2]);
+  }
+
+  // A mirrored basis is flipped into a rotation and the scales negated.
+  __m256 cross[3];
+  crossLanes(c[1], c[2], cross);
+  __m256 flip = _mm256_and_ps(
+      _mm256_cmp_ps(dotLanes(c[0], cross), _mm256_setzero_ps(), _CMP_LT_OQ),
+      _mm256_set1_ps(-0.0f));
+  for (int i = 0; i < 3; ++i) {
+    scale[i] = _mm256_xor_ps(scale[i], flip);
+    for (int r = 0; r < 3; ++r) {
+      c[i][r] = _mm256_xor_ps(c[i][r], flip);
+    }
+  }
+  __m256 q[4];
+  getColumnsRotationLanes(c, q);
+
+  float lanes[13][8];
+  for (int r = 0; r < 3; ++r) {
+    _mm256_storeu_ps(lanes[r], gatherLanes(base, offsets, 12 + r));
+    _mm256_storeu_ps(lanes[7 + r], scale[r]);
+    _mm256_storeu_ps(lanes[10 + r], skew[r]);
+  }
+  for (int r = 0; r < 4; ++r) {
+    _mm256_storeu_ps(lanes[3 + r], q[r]);
+  }
+  for (int j = 0; j < 8; ++j) {
+    TransformParts &parts = out[j];
+    parts.translation = glm::vec3(lanes[0][j], lanes[1][j], lanes[2][j]);
+    parts.rotation =
+        glm::quat(lanes[6][j], lanes[3][j], lanes[4][j], lanes[5][j]);
+    parts.scale = glm::vec3(lanes[7][j], lanes[8][j], lanes[9][j]);
+    parts.skew = glm::vec3(lanes[10][j], lanes[11][j], lanes[12][j]);
+  }
+  return true;
+}
+
+SIMD_AVX2 __m256 getSquaredNormLanes(const __m256 x[3][3]) {
+  return _mm256_add_ps(_mm256_add_ps(dotLanes(x[0], x[0]),
+                                     dotLanes(x[1], x[1])),
+                       dotLanes(x[2], x[2]));
+}
+
+// polarDecomposeScalar on eight matrices at once. Every matrix iterates
+// until the slowest one converges.
+SIMD_AVX2 void polarDecomposeLanes(const glm::mat3 m[], glm::quat rotations[],
+                                   glm::mat3 stretches[]) {
+  const float *base = &m[0][0][0];
+  __m256i offsets = _mm256_setr_epi32(0, 9, 18, 27, 36, 45, 54, 63);
+  __m256 a[3][3], x[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int r = 0; r < 3; ++r) {
+      a[i][r] = gatherLanes(base, offsets, i * 3 + r);
+    }
+  }
+  __m256 y[3][3];
+  crossLanes(a[1], a[2], y[0]);
+  __m256 flip = _mm256_and_ps(
+      _mm256_cmp_ps(dotLanes(a[0], y[0]), _mm256_setzero_ps(), _CMP_LT_OQ),
+      _mm256_set1_ps(-0.0f));
+  for (int i = 0; i < 3; ++i) {
+    for (int r = 0; r < 3; ++r) {
+      x[i][r] = _mm256_xor_ps(a[i][r], flip);
+    }
+  }
+
+  __m256 half = _mm256_set1_ps(0.5f);
+  for (int iteration = 0; iteration < POLAR_MAX_ITERATIONS; ++iteration) {
+    crossLanes(x[1], x[2], y[0]);
+    crossLanes(x[2], x[0], y[1]);
+    crossLanes(x[0], x[1], y[2]);
+    __m256 det = dotLanes(x[0], y[0]);
+    __m256 ratio =
+        _mm256_div_ps(getSquaredNormLanes(y),
+                      _mm256_mul_ps(_mm256_mul_ps(det, det),
+                                    getSquaredNormLanes(x)));
+    __m256 gamma = _mm256_sqrt_ps(_mm256_sqrt_ps(ratio));
+    __m256 xScale = _mm256_mul_ps(half, gamma);
+    __m256 yScale = _mm256_div_ps(half, _mm256_mul_ps(gamma, det));
+    __m256 change = _mm256_setzero_ps();
+    for (int i = 0; i < 3; ++i) {
+      for (int r = 0; r < 3; ++r) {
+        __m256 next =
+            _mm256_fmadd_ps(x[i][r], xScale, _mm256_mul_ps(y[i][r], yScale));
+        __m256 delta = _mm256_sub_ps(next, x[i][r]);
+        change = _mm256_fmadd_ps(delta, delta, change);
+        x[i][r] = next;
+      }
+    }
+    __m256 done =
+        _mm256_cmp_ps(change, _mm256_set1_ps(POLAR_TOLERANCE), _CMP_LT_OQ);
+    if (_mm256_movemask_ps(done) == 0xFF) {
+      break;
+    }
+  }
+
+  // stretch = transpose(x) * m, made exactly symmetric.
+  __m256 s[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int r = 0; r < 3; ++r) {
+      s[i][r] = dotLanes(x[r], a[i]);
+    }
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int r = i + 1; r < 3; ++r) {
+      s[i][r] = _mm256_mul_ps(half, _mm256_add_ps(s[i][r], s[r][i]));
+      s[r][i] = s[i][r];
+    }
+  }
+  __m256 q[4];
+  getColumnsRotationLanes(x, q);
+
+  float lanes[13][8];
+  for (int r = 0; r < 4; ++r) {
+    _mm256_storeu_ps(lanes[r], q[r]);
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int r = 0; r < 3; ++r) {
+      _mm256_storeu_ps(lanes[4 + i * 3 + r], s[i][r]);
+    }
+  }
+  for (int j = 0; j < 8; ++j) {
+    rotations[j] =
+        glm::quat(lanes[3][j], lanes[0][j], lanes[1][j], lanes[2][j]);
+    for (int i = 0; i < 3; ++i) {
+      stretches[j][i] = glm::vec3(lanes[4 + i * 3][j], lanes[5 + i * 3][j],
+                                  lanes[6 + i * 3][j]);
+    }
+  }
+}
+#endif
+
+size_t decomposeTransforms(const glm::mat4 m[], TransformParts out[],
+                           size_t count) {
+  unsigned int threads = getParallelThreads(count, DECOMPOSE_MIN_PER_THREAD);
+  std::vector<size_t> failures(threads, 0);
+  size_t chunk = (count + threads - 1) / threads;
+  parallelFor(threads, 1, [&](size_t begin, size_t end) {
+    for (size_t t = begin; t < end; ++t) {
+      size_t i = std::min(count, t * chunk);
+      size_t last = std::min(count, i + chunk);
+#ifdef SIMD_X86
+      if (cpuHasAvx2()) {
+        for (; i + 8 <= last; i += 8) {
+          if (decomposeLanes(m + i, false, out + i)) {
+            continue;
+          }
+          for (size_t j = i; j < i + 8; ++j) {
+            failures[t] += !decomposeScalar(m[j], out[j]);
+          }
+        }
+      }
+#endif
+      for (; i < last; ++i) {
+        failures[t] += !decomposeScalar(m[i], out[i]);
+      }
+    }
+  });
+  size_t total = 0;
+  for (size_t f : failures) {
+    total += f;
+  }
+  return total;
+}
+
+void decomposeTrs(const glm::mat4 m[], TransformParts out[], size_t count) {
+  parallelFor(count, DECOMPOSE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      for (; i + 8 <= end; i += 8) {
+        decomposeLanes(m + i, true, out + i);
+      }
+    }
+#endif
+    for (; i < end; ++i) {
+      decomposeTrsScalar(m[i], out[i]);
+    }
+  });
+}
+
+void polarDecompose(const glm::mat3 m[], glm::quat rotations[],
+                    glm::mat3 stretches[], size_t count) {
+  parallelFor(count, DECOMPOSE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      for (; i + 8 <= end; i += 8) {
+        polarDecomposeLanes(m + i, rotations + i, stretches + i);
+      }
+    }
+#endif
+    for (; i < end; ++i) {
+      polarDecomposeScalar(m[i], rotations[i], stretches[i]);
+    }
+  });
+}
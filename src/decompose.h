@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// The parts glm::decompose returns for a matrix without perspective, so
+// glm::recompose rebuilds it.
+struct TransformParts {
+  glm::vec3 translation;
+  glm::quat rotation;
+  glm::vec3 scale;
+  glm::vec3 skew;
+};
+
+// Decomposes count matrices as glm::decompose does. Affine matrices run
+// eight per AVX2 iteration, split across threads; eight-matrix blocks
+// holding a perspective or near-singular matrix go through glm::decompose.
+// Returns how many matrices could not be decomposed; those get zero scale
+// and the identity rotation.
+size_t decomposeTransforms(const glm::mat4 m[], TransformParts out[],
+                           size_t count);
+
+// Fast path for matrices known to be translation * rotation * scale, with
+// no skew, perspective or zero scale: scale is the column lengths and skew
+// is zero. Results match decomposeTransforms on such matrices.
+void decomposeTrs(const glm::mat4 m[], TransformParts out[], size_t count);
+
+// Polar decomposition m = rotation * stretch, with stretch symmetric: the
+// rotation closest to m, free of the axis-order bias of decompose's
+// Gram-Schmidt. Higham's scaled Newton iteration, eight matrices per AVX2
+// iteration. Mirrored matrices keep the reflection in stretch, as negative
+// eigenvalues. m must not be singular.
+void polarDecompose(const glm::mat3 m[], glm::quat rotations[],
+                    glm::mat3 stretches[], size_t count);
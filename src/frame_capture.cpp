@@ -0,0 +1,244 @@
+#include "frame_capture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "color_space.h"
+
+bool hasExtension(const char *path, const char *extension) {
+  size_t length = strlen(path), extensionLength = strlen(extension);
+  return length >= extensionLength &&
+         strcmp(path + length - extensionLength, extension) == 0;
+}
+
+// True if pattern has exactly one int conversion (%d, %05d, %x, ...) and no
+// other conversion than %%, so snprintf gives every frame its own name.
+bool isFramePattern(const char *pattern) {
+  int conversions = 0;
+  for (const char *c = pattern; *c; ++c) {
+    if (*c != '%') {
+      continue;
+    }
+    if (*++c == '%') {
+      continue;
+    }
+    c += strspn(c, "-+ #0");
+    c += strspn(c, "0123456789");
+    if (*c == '.') {
+      c += 1 + strspn(c + 1, "0123456789");
+    }
+    if (!*c || !strchr("diouxX", *c)) {
+      return false;
+    }
+    conversions++;
+  }
+  return conversions == 1;
+}
+
+bool FrameCapture::start(const char *pattern, int ringSize) {
+  if (!isFramePattern(pattern)) {
+    std::cerr << "Capture pattern " << pattern
+              << " must contain exactly one integer conversion such as %05d"
+              << std::endl;
+    return false;
+  }
+  this->pattern = pattern;
+  this->ringSize = ringSize;
+  if (hasExtension(pattern, ".ppm")) {
+    format = CAPTURE_PPM;
+  } else if (hasExtension(pattern, ".pfm")) {
+    format = CAPTURE_PFM;
+  } else {
+    format = CAPTURE_RAW;
+  }
+  frameCount = 0;
+  dropCount = 0;
+  stopping = false;
+  encoder = std::thread(&FrameCapture::encode, this);
+  return true;
+}
+
+void FrameCapture::allocate(int width, int height) {
+  this->width = width;
+  this->height = height;
+  size_t size = (size_t)width * height * 4;
+
+  // Persistently mapped, so the encoder reads a frame in place once its
+  // fence has signalled.
+  ring.resize(ringSize);
+  for (Slot &slot : ring) {
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glBufferStorage(GL_PIXEL_PACK_BUFFER, size, NULL,
+                    GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT |
+                        GL_MAP_COHERENT_BIT);
+    slot.pixels = (const unsigned char *)glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, size,
+        GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+    slot.fence = 0;
+    slot.frame = -1;
+    slot.encoding = false;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  nextSlot = 0;
+  nextCollect = 0;
+}
+
+void FrameCapture::release() {
+  collect(true);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [this] {
+      for (const Slot &slot : ring) {
+        if (slot.encoding) {
+          return false;
+        }
+      }
+      return true;
+    });
+  }
+  for (Slot &slot : ring) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glDeleteBuffers(1, &slot.buffer);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  ring.clear();
+}
+
+// Hands finished readbacks to the encoder, oldest first so frames are written
+// in order. Stops at the first one the GPU is still writing unless block is
+// set.
+void FrameCapture::collect(bool block) {
+  while (!ring.empty() && ring[nextCollect].fence != 0) {
+    Slot &slot = ring[nextCollect];
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     block ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+      return;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      slot.encoding = true;
+      queue.push_back(nextCollect);
+    }
+    ready.notify_one();
+    nextCollect = (nextCollect + 1) % ring.size();
+  }
+}
+
+void FrameCapture::capture(int width, int height) {
+  if (pattern.empty() || width <= 0 || height <= 0) {
+    return;
+  }
+  if (ring.empty() || width != this->width || height != this->height) {
+    release();
+    allocate(width, height);
+  }
+
+  // Only waits on the GPU when every buffer still has a readback in flight,
+  // which the ring size makes rare.
+  Slot &slot = ring[nextSlot];
+  collect(slot.fence != 0);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot.encoding) {
+      dropCount++;
+      return;
+    }
+  }
+  nextSlot = (nextSlot + 1) % ring.size();
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.frame = frameCount++;
+}
+
+void FrameCapture::finish() {
+  if (!encoder.joinable()) {
+    return;
+  }
+
+  release();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  ready.notify_one();
+  encoder.join();
+}
+
+void FrameCapture::encode() {
+  for (;;) {
+    int index;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      ready.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty()) {
+        return;
+      }
+      index = queue.front();
+      queue.pop_front();
+    }
+
+    // The ring is not reallocated while a slot is encoding.
+    writeFrame(ring[index]);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ring[index].encoding = false;
+    }
+    drained.notify_one();
+  }
+}
+
+void FrameCapture::writeFrame(const Slot &slot) const {
+  char path[1024];
+  snprintf(path, sizeof(path), pattern.c_str(), slot.frame);
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    std::cerr << "Cannot write " << path << std::endl;
+    return;
+  }
+
+  // GL rows start at the bottom; files start at the top.
+  size_t stride = (size_t)width * 4;
+  if (format == CAPTURE_PPM) {
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row(width * 3);
+    for (int y = height - 1; y >= 0; --y) {
+      const unsigned char *source = &slot.pixels[y * stride];
+      for (int x = 0; x < width; ++x) {
+        row[3 * x] = source[4 * x];
+        row[3 * x + 1] = source[4 * x + 1];
+        row[3 * x + 2] = source[4 * x + 2];
+      }
+      fwrite(row.data(), 1, row.size(), file);
+    }
+  } else if (format == CAPTURE_PFM) {
+    // PFM rows start at the bottom like GL's. A negative scale marks
+    // little-endian floats.
+    fprintf(file, "PF\n%d %d\n-1.0\n", width, height);
+    std::vector<float> row(width * 4);
+    for (int y = 0; y < height; ++y) {
+      srgb8ToLinear(&slot.pixels[y * stride], row.data(), stride);
+      for (int x = 0; x < width; ++x) {
+        row[3 * x] = row[4 * x];
+        row[3 * x + 1] = row[4 * x + 1];
+        row[3 * x + 2] = row[4 * x + 2];
+      }
+      fwrite(row.data(), sizeof(float), width * 3, file);
+    }
+  } else {
+    for (int y = height - 1; y >= 0; --y) {
+      fwrite(&slot.pixels[y * stride], 1, stride, file);
+    }
+  }
+  fclose(file);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum CaptureFormat { CAPTURE_PPM, CAPTURE_PFM, CAPTURE_RAW };
+
+// Saves rendered frames without stalling the GPU or the render thread. Each
+// capture() queues a glReadPixels into the next pixel buffer of a ring and
+// fences it. Once the fence has signalled, the buffer itself is handed to an
+// encoder thread, which writes the file straight from the mapping and gives
+// the buffer back. A frame whose buffer is still being written is dropped
+// rather than waited for.
+class FrameCapture {
+public:
+  ~FrameCapture() { finish(); }
+
+  // pattern is a printf pattern taking the frame number, e.g.
+  // "frames/%05d.ppm". Files ending in .ppm are written as binary PPM,
+  // .pfm as linear-light float PFM, and anything else as raw top-down RGBA8.
+  // Returns false if pattern does not hold exactly one integer conversion.
+  bool start(const char *pattern, int ringSize = 8);
+  // Reads back the current read framebuffer. Call after the frame is drawn
+  // and before it is swapped.
+  void capture(int width, int height);
+  // Collects outstanding readbacks and waits for the encoder to finish.
+  void finish();
+
+  bool active() const { return !ring.empty(); }
+  int capturedFrames() const { return frameCount; }
+  // Frames skipped because the encoder still held the next buffer.
+  int droppedFrames() const { return dropCount; }
+
+private:
+  struct Slot {
+    GLuint buffer;
+    const unsigned char *pixels;
+    GLsync fence;
+    int frame;
+    // Set while the encoder owns the buffer; guarded by mutex.
+    bool encoding;
+  };
+
+  void allocate(int width, int height);
+  void release();
+  void collect(bool block);
+  void encode();
+  void writeFrame(const Slot &slot) const;
+
+  std::string pattern;
+  CaptureFormat format = CAPTURE_RAW;
+  int ringSize = 0;
+  int width = 0;
+  int height = 0;
+  int frameCount = 0;
+  int dropCount = 0;
+  int nextSlot = 0;
+  // Oldest slot whose readback has not been handed to the encoder.
+  int nextCollect = 0;
+  std::vector<Slot> ring;
+
+  std::thread encoder;
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::condition_variable drained;
+  std::deque<int> queue;
+  bool stopping = false;
+};
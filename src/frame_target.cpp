@@ -0,0 +1,125 @@
+#include "frame_target.h"
+
+#include <algorithm>
+#include <iostream>
+
+void FrameTarget::init(AntialiasMode mode, int samples, GLuint fxaaProgram,
+                       int width, int height) {
+  this->mode = mode;
+  this->fxaaProgram = fxaaProgram;
+  this->width = width;
+  this->height = height;
+  this->samples = 0;
+
+  if (mode == AA_MSAA) {
+    GLint maxSamples;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    this->samples = std::min<int>(samples, maxSamples);
+  } else if (mode == AA_FXAA) {
+    glGenVertexArrays(1, &vao);
+    texelSizeLocation = glGetUniformLocation(fxaaProgram, "texelSize");
+  }
+
+  if (!createAttachments()) {
+    std::cerr << "Anti-aliasing framebuffer is incomplete; drawing without it"
+              << std::endl;
+    release();
+  }
+}
+
+bool FrameTarget::createAttachments() {
+  if (mode == AA_OFF) {
+    return true;
+  }
+
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+  if (mode == AA_MSAA) {
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width,
+                                     height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, colorRenderbuffer);
+  } else {
+    // FXAA samples neighbours with bilinear filtering.
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           colorTexture, 0);
+  }
+
+  bool complete =
+      glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (!complete) {
+    deleteAttachments();
+  }
+  return complete;
+}
+
+void FrameTarget::deleteAttachments() {
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteRenderbuffers(1, &colorRenderbuffer);
+  glDeleteTextures(1, &colorTexture);
+  framebuffer = colorRenderbuffer = colorTexture = 0;
+}
+
+// Minimized windows report 0x0; the attachments are kept for the restore.
+// A failed resize draws without anti-aliasing until the next one succeeds,
+// but keeps the mode.
+void FrameTarget::resize(int width, int height) {
+  if (mode == AA_OFF || width == 0 || height == 0 ||
+      (width == this->width && height == this->height)) {
+    return;
+  }
+
+  this->width = width;
+  this->height = height;
+  deleteAttachments();
+  if (!createAttachments()) {
+    std::cerr << "Anti-aliasing framebuffer is incomplete at " << width << "x"
+              << height << std::endl;
+  }
+}
+
+void FrameTarget::release() {
+  deleteAttachments();
+  glDeleteVertexArrays(1, &vao);
+  vao = 0;
+  mode = AA_OFF;
+  samples = 0;
+}
+
+void FrameTarget::begin() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void FrameTarget::resolve() const {
+  if (mode == AA_OFF || framebuffer == 0) {
+    return;
+  }
+
+  if (mode == AA_MSAA) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return;
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glUseProgram(fxaaProgram);
+  glUniform2f(texelSizeLocation, 1.0 / width, 1.0 / height);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, colorTexture);
+  glBindVertexArray(vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+}
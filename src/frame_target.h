@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+
+enum AntialiasMode { AA_OFF, AA_MSAA, AA_FXAA };
+
+// Where task2 renders a frame before it reaches the window. AA_OFF draws to
+// the default framebuffer directly. AA_MSAA draws into a multisampled
+// renderbuffer that is resolved with glBlitFramebuffer, and AA_FXAA draws
+// into a texture that a full-screen FXAA pass filters onto the window.
+class FrameTarget {
+public:
+  // samples is only used by AA_MSAA and fxaaProgram only by AA_FXAA.
+  void init(AntialiasMode mode, int samples, GLuint fxaaProgram, int width,
+            int height);
+  void resize(int width, int height);
+  void release();
+  void setFxaaProgram(GLuint program) { fxaaProgram = program; }
+
+  void begin() const;
+  void resolve() const;
+
+  AntialiasMode getMode() const { return mode; }
+  int getSamples() const { return samples; }
+
+private:
+  bool createAttachments();
+  void deleteAttachments();
+
+  AntialiasMode mode = AA_OFF;
+  int samples = 0;
+  int width = 0;
+  int height = 0;
+
+  GLuint framebuffer = 0;
+  GLuint colorRenderbuffer = 0;
+  GLuint colorTexture = 0;
+  GLuint vao = 0;
+  GLuint fxaaProgram = 0;
+  GLint texelSizeLocation = -1;
+};
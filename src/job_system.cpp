@@ -0,0 +1,103 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+// The pool and worker index of the calling thread, if it is a worker.
+thread_local const JobSystem *currentSystem = nullptr;
+thread_local unsigned int currentWorker = 0;
+
+JobSystem::JobSystem(unsigned int threadCount) {
+  if (threadCount == 0) {
+    // Leave a core for the render thread.
+    // hardware_concurrency() may report 0 when it is unknown.
+    threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+  }
+
+  for (unsigned int i = 0; i < threadCount; ++i) {
+    workers.push_back(std::make_unique<Worker>());
+  }
+  for (unsigned int i = 0; i < threadCount; ++i) {
+    threads.emplace_back(&JobSystem::run, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+void JobSystem::submit(std::function<void()> job) {
+  pending++;
+  unsigned int index = currentSystem == this
+                           ? currentWorker
+                           : nextWorker.fetch_add(1) % workers.size();
+  Worker &worker = *workers[index];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.jobs.push_back(std::move(job));
+    queued++;
+  }
+  {
+    // Taking the lock orders the push before a sleeping worker rechecks.
+    std::lock_guard<std::mutex> lock(sleepMutex);
+  }
+  wake.notify_one();
+}
+
+void JobSystem::wait() {
+  std::unique_lock<std::mutex> lock(sleepMutex);
+  finished.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool JobSystem::popJob(unsigned int index, std::function<void()> &job) {
+  {
+    Worker &own = *workers[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      queued--;
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < workers.size(); ++i) {
+    Worker &victim = *workers[(index + i) % workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      queued--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void JobSystem::run(unsigned int index) {
+  currentSystem = this;
+  currentWorker = index;
+  std::function<void()> job;
+  // Checked before every pop so the destructor does not wait for the queue
+  // to drain.
+  while (!stopping) {
+    if (popJob(index, job)) {
+      job();
+      job = nullptr;
+      if (--pending == 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        finished.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wake.wait(lock, [this] { return stopping.load() || queued.load() > 0; });
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads with one job deque per worker. Jobs submitted
+// from outside the pool are dealt round-robin; jobs submitted from inside a
+// job go to that worker's own deque. A worker runs its own newest job first
+// and steals the oldest job of another worker when its deque is empty, so
+// uneven jobs spread across the pool without a single contended queue.
+class JobSystem {
+public:
+  explicit JobSystem(unsigned int threadCount = 0);
+  // Joins the workers. Jobs that have not started yet are dropped.
+  ~JobSystem();
+
+  // Safe to call from any thread, including from inside a job.
+  void submit(std::function<void()> job);
+  // Blocks until every submitted job has finished.
+  void wait();
+  int pendingJobs() const { return pending.load(); }
+  int threadCount() const { return threads.size(); }
+
+private:
+  struct Worker {
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+  };
+
+  void run(unsigned int index);
+  bool popJob(unsigned int index, std::function<void()> &job);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<int> pending{0};
+  std::atomic<int> queued{0};
+  std::atomic<bool> stopping{false};
+  std::atomic<unsigned int> nextWorker{0};
+
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+};
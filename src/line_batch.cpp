@@ -0,0 +1,52 @@
+#include "line_batch.h"
+
+#include <algorithm>
+
+void LineBatch::addPolyline(const glm::vec2 points[], const glm::vec3 colors[],
+                            int numPoints, float width, LineCap cap,
+                            GLuint shapeIndex) {
+  for (int i = 0; i + 1 < numPoints; ++i) {
+    LineSegment segment;
+    segment.from = points[i];
+    segment.to = points[i + 1];
+    segment.fromColor = glm::vec4(colors[i], 1.0);
+    segment.toColor = glm::vec4(colors[i + 1], 1.0);
+    segment.width = width;
+    segment.shapeIndex = shapeIndex;
+    segment.startCap = (i == 0) ? cap : CAP_ROUND;
+    segment.endCap = (i + 2 == numPoints) ? cap : CAP_ROUND;
+    segments.push_back(segment);
+  }
+}
+
+void LineBatch::upload(GLuint program) {
+  glGenVertexArrays(1, &vao);
+
+  glGenBuffers(1, &segmentBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, segmentBuffer);
+  // Zero-size storage is an error, so scenes without lines get one unused
+  // segment.
+  glBufferStorage(GL_SHADER_STORAGE_BUFFER,
+                  std::max<size_t>(segments.size(), 1) * sizeof(LineSegment),
+                  segments.empty() ? NULL : segments.data(), 0);
+
+  viewportSizeLocation = glGetUniformLocation(program, "viewportSize");
+}
+
+void LineBatch::draw(glm::vec2 viewportSize) const {
+  if (segments.empty()) {
+    return;
+  }
+
+  glUniform2f(viewportSizeLocation, viewportSize.x, viewportSize.y);
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glBindVertexArray(vao);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LINE_BUFFER_BINDING,
+                   segmentBuffer);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, segments.size());
+
+  glDisable(GL_BLEND);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+const GLuint LINE_BUFFER_BINDING = 2;
+
+enum LineCap { CAP_BUTT, CAP_ROUND, CAP_SQUARE };
+
+// One instance of the line shader. Layout matches std430. Points are in the
+// shape's local space; width is in framebuffer pixels.
+struct LineSegment {
+  glm::vec2 from;
+  glm::vec2 to;
+  glm::vec4 fromColor;
+  glm::vec4 toColor;
+  float width;
+  GLuint shapeIndex;
+  GLuint startCap;
+  GLuint endCap;
+};
+
+// Draws polylines as one instanced quad per segment. The vertex shader
+// expands each segment in screen space, so widths stay constant under zoom,
+// and the fragment shader anti-aliases the edge by its pixel distance to the
+// segment. Segments end in round caps inside a polyline, which gives round
+// joins; the polyline's own ends use the requested cap.
+class LineBatch {
+public:
+  void addPolyline(const glm::vec2 points[], const glm::vec3 colors[],
+                   int numPoints, float width, LineCap cap, GLuint shapeIndex);
+
+  void upload(GLuint program);
+  void draw(glm::vec2 viewportSize) const;
+
+  int segmentCount() const { return segments.size(); }
+
+private:
+  std::vector<LineSegment> segments;
+
+  GLuint vao = 0;
+  GLuint segmentBuffer = 0;
+  GLint viewportSizeLocation = -1;
+};
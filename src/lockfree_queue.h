@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded multi-producer multi-consumer queue (Vyukov). Each slot carries a
+// sequence number telling producers and consumers whose turn it is, so push
+// and pop are a single compare-and-swap on the shared cursor and never block.
+// Capacity must be a power of two.
+template <typename T> class LockFreeQueue {
+public:
+  explicit LockFreeQueue(size_t capacity)
+      : slots(new Slot[capacity]), mask(capacity - 1) {
+    for (size_t i = 0; i < capacity; ++i) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Returns false when the queue is full.
+  bool push(const T &value) {
+    size_t position = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &slot = slots[position & mask];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+      if (difference == 0) {
+        if (tail.compare_exchange_weak(position, position + 1,
+                                       std::memory_order_relaxed)) {
+          slot.value = value;
+          slot.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns false when the queue is empty.
+  bool pop(T &value) {
+    size_t position = head.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &slot = slots[position & mask];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+      if (difference == 0) {
+        if (head.compare_exchange_weak(position, position + 1,
+                                       std::memory_order_relaxed)) {
+          value = slot.value;
+          slot.sequence.store(position + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Slot[]> slots;
+  size_t mask;
+  // Producers and consumers touch different cursors; keep them on separate
+  // cache lines.
+  alignas(64) std::atomic<size_t> tail{0};
+  alignas(64) std::atomic<size_t> head{0};
+};
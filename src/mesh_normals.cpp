@@ -0,0 +1,186 @@
+#include "mesh_normals.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "normalize.h"
+#include "parallel.h"
+#include "simd.h"
+
+const size_t MESH_MIN_PER_THREAD = 1 << 16;
+
+// cross(b - a, c - a) for one triangle, twice its area along its normal.
+glm::vec3 getFaceCross(const glm::vec3 positions[], const uint32_t indices[]) {
+  glm::vec3 a = positions[indices[0]];
+  return glm::cross(positions[indices[1]] - a, positions[indices[2]] - a);
+}
+
+#ifdef SIMD_X86
+// Face crosses of count triangles starting at indices, eight per iteration,
+// scaled to unit length when normalize is set. Returns how many were done.
+SIMD_AVX2 size_t getFaceCrossesAvx2(const glm::vec3 positions[],
+                                    const uint32_t indices[], size_t count,
+                                    glm::vec3 out[], bool normalize) {
+  const float *base = &positions[0].x;
+  // Corner k of triangle j is index 3 j + k. The blends pick that index for
+  // each j from the three loads, and the permutes put it in lane j.
+  __m256i order[3] = {_mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5),
+                      _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6),
+                      _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7)};
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i *triangles = (const __m256i *)(indices + i * 3);
+    __m256i a = _mm256_loadu_si256(triangles);
+    __m256i b = _mm256_loadu_si256(triangles + 1);
+    __m256i c = _mm256_loadu_si256(triangles + 2);
+    __m256i corners[3] = {
+        _mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x92), c, 0x24),
+        _mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x24), c, 0x49),
+        _mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x49), c, 0x92)};
+    __m256 p[3][3];
+    for (int k = 0; k < 3; ++k) {
+      __m256i vertex = _mm256_permutevar8x32_epi32(corners[k], order[k]);
+      __m256i offset = _mm256_add_epi32(vertex, _mm256_slli_epi32(vertex, 1));
+      p[k][0] = _mm256_i32gather_ps(base, offset, 4);
+      p[k][1] = _mm256_i32gather_ps(base + 1, offset, 4);
+      p[k][2] = _mm256_i32gather_ps(base + 2, offset, 4);
+    }
+    __m256 u[3], v[3], n[3];
+    for (int d = 0; d < 3; ++d) {
+      u[d] = _mm256_sub_ps(p[1][d], p[0][d]);
+      v[d] = _mm256_sub_ps(p[2][d], p[0][d]);
+    }
+    crossLanes(u, v, n);
+    if (normalize) {
+      // One divide for all three components, as glm::normalize does.
+      __m256 length = _mm256_sqrt_ps(dotLanes(n, n));
+      __m256 scale = _mm256_div_ps(_mm256_set1_ps(1.0f), length);
+      for (int d = 0; d < 3; ++d) {
+        n[d] = _mm256_mul_ps(n[d], scale);
+      }
+    }
+    storeVec3Lanes(&out[i].x, n);
+  }
+  return i;
+}
+#endif
+
+// Calls accumulate(begin, end, sums) on chunks of the triangles, one chunk
+// per thread. Thread 0 adds into sums and the others into zeroed buffers of
+// their own, which are then added into sums.
+template <typename T, typename F>
+void accumulateVertices(size_t vertexCount, size_t triangleCount, T sums[],
+                        const F &accumulate) {
+  unsigned int threads = getParallelThreads(triangleCount, MESH_MIN_PER_THREAD);
+  size_t chunk = (triangleCount + threads - 1) / threads;
+  std::vector<std::vector<T>> partials(threads - 1);
+  parallelFor(threads, 1, [&](size_t begin, size_t end) {
+    for (size_t t = begin; t < end; ++t) {
+      T *target = sums;
+      if (t == 0) {
+        std::fill(sums, sums + vertexCount, T{});
+      } else {
+        partials[t - 1].assign(vertexCount, T{});
+        target = partials[t - 1].data();
+      }
+      accumulate(std::min(triangleCount, t * chunk),
+                 std::min(triangleCount, (t + 1) * chunk), target);
+    }
+  });
+  parallelFor(vertexCount, MESH_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    for (const std::vector<T> &partial : partials) {
+      for (size_t v = begin; v < end; ++v) {
+        sums[v] += partial[v];
+      }
+    }
+  });
+}
+
+void computeFaceNormals(const glm::vec3 positions[], const uint32_t indices[],
+                        size_t triangleCount, glm::vec3 normals[]) {
+  parallelFor(triangleCount, MESH_MIN_PER_THREAD,
+              [&](size_t begin, size_t end) {
+                size_t i = begin;
+#ifdef SIMD_X86
+                if (cpuHasAvx2()) {
+                  i += getFaceCrossesAvx2(positions, indices + begin * 3,
+                                          end - begin, normals + begin, true);
+                }
+#endif
+                for (; i < end; ++i) {
+                  glm::vec3 cross = getFaceCross(positions, indices + i * 3);
+                  normals[i] = glm::normalize(cross);
+                }
+              });
+}
+
+void computeVertexNormals(const glm::vec3 positions[], size_t vertexCount,
+                          const uint32_t indices[], size_t triangleCount,
+                          glm::vec3 normals[]) {
+  // Each thread computes the crosses of a block of its triangles into a
+  // small buffer, then scatters them into its sums.
+  const size_t BLOCK = 256;
+  accumulateVertices(
+      vertexCount, triangleCount, normals,
+      [&](size_t begin, size_t end, glm::vec3 sums[]) {
+        glm::vec3 crosses[BLOCK];
+        for (size_t i = begin; i < end; i += BLOCK) {
+          const uint32_t *block = indices + i * 3;
+          size_t count = std::min(BLOCK, end - i);
+          size_t j = 0;
+#ifdef SIMD_X86
+          if (cpuHasAvx2()) {
+            j = getFaceCrossesAvx2(positions, block, count, crosses, false);
+          }
+#endif
+          for (; j < count; ++j) {
+            crosses[j] = getFaceCross(positions, block + j * 3);
+          }
+          for (j = 0; j < count; ++j) {
+            const uint32_t *triangle = block + j * 3;
+            sums[triangle[0]] += crosses[j];
+            sums[triangle[1]] += crosses[j];
+            sums[triangle[2]] += crosses[j];
+          }
+        }
+      });
+  normalizeVectors(normals, normals, vertexCount, NORMALIZE_EXACT);
+}
+
+void computeVertexTangents(const glm::vec3 positions[],
+                           const glm::vec2 texCoords[],
+                           const glm::vec3 normals[], size_t vertexCount,
+                           const uint32_t indices[], size_t triangleCount,
+                           glm::vec4 tangents[]) {
+  // Sums the triangle tangents in xyz and their handedness, the sign of the
+  // texture space determinant, in w.
+  accumulateVertices(
+      vertexCount, triangleCount, tangents,
+      [&](size_t begin, size_t end, glm::vec4 sums[]) {
+        for (size_t i = begin; i < end; ++i) {
+          const uint32_t *triangle = indices + i * 3;
+          glm::vec3 a = positions[triangle[0]];
+          glm::vec3 u = positions[triangle[1]] - a;
+          glm::vec3 v = positions[triangle[2]] - a;
+          glm::vec2 uv = texCoords[triangle[0]];
+          glm::vec2 du = texCoords[triangle[1]] - uv;
+          glm::vec2 dv = texCoords[triangle[2]] - uv;
+          float determinant = du.x * dv.y - dv.x * du.y;
+          if (determinant == 0.0f) {
+            continue;
+          }
+          glm::vec4 tangent((u * dv.y - v * du.y) / determinant,
+                            determinant > 0.0f ? 1.0f : -1.0f);
+          sums[triangle[0]] += tangent;
+          sums[triangle[1]] += tangent;
+          sums[triangle[2]] += tangent;
+        }
+      });
+  parallelFor(vertexCount, MESH_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    for (size_t v = begin; v < end; ++v) {
+      glm::vec3 n = normals[v], t = glm::vec3(tangents[v]);
+      t = glm::normalize(t - n * glm::dot(n, t));
+      tangents[v] = glm::vec4(t, tangents[v].w < 0.0f ? -1.0f : 1.0f);
+    }
+  });
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Normals and tangents for indexed triangle meshes, three indices per
+// triangle with counter-clockwise front faces. Triangles run eight at a
+// time through AVX2 gathers when the CPU has it, split across threads. The
+// gathers use 32-bit offsets, so vertexCount must stay below 2^29.
+
+// Unit normal of each triangle, matching glm::triangleNormal. Degenerate
+// triangles give NaN.
+void computeFaceNormals(const glm::vec3 positions[], const uint32_t indices[],
+                        size_t triangleCount, glm::vec3 normals[]);
+
+// Area-weighted smooth normals. Each thread adds its triangles into its own
+// buffer of vertexCount sums, so there are no atomics, and the buffers are
+// added and normalized in bulk. Vertices no triangle uses give NaN.
+void computeVertexNormals(const glm::vec3 positions[], size_t vertexCount,
+                          const uint32_t indices[], size_t triangleCount,
+                          glm::vec3 normals[]);
+
+// Per-vertex tangents from texture coordinates, orthogonalized against
+// normals. w is the bitangent sign, so bitangent = cross(normal, xyz) * w,
+// taken from the majority of the vertex's triangles. Vertices whose
+// triangles all have degenerate texture coordinates give NaN.
+void computeVertexTangents(const glm::vec3 positions[],
+                           const glm::vec2 texCoords[],
+                           const glm::vec3 normals[], size_t vertexCount,
+                           const uint32_t indices[], size_t triangleCount,
+                           glm::vec4 tangents[]);
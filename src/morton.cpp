@@ -0,0 +1,158 @@
+#include "morton.h"
+
+#include <array>
+
+#include "parallel.h"
+#include "simd.h"
+
+const size_t MORTON_MIN_PER_THREAD = 1 << 16;
+const float MORTON_GRID_MAX = 65535.0f;
+
+uint32_t spreadMortonBits(uint32_t v) {
+  v &= 0xFFFF;
+  v = (v | (v << 8)) & 0x00FF00FF;
+  v = (v | (v << 4)) & 0x0F0F0F0F;
+  v = (v | (v << 2)) & 0x33333333;
+  v = (v | (v << 1)) & 0x55555555;
+  return v;
+}
+
+glm::vec2 getMortonScale(const AABB &bounds) {
+  glm::vec2 extent = bounds.max - bounds.min;
+  return glm::vec2(extent.x > 0.0f ? MORTON_GRID_MAX / extent.x : 0.0f,
+                   extent.y > 0.0f ? MORTON_GRID_MAX / extent.y : 0.0f);
+}
+
+uint32_t quantizeMorton(float value, float min, float scale) {
+  return (uint32_t)glm::clamp((value - min) * scale, 0.0f, MORTON_GRID_MAX);
+}
+
+void encodeMortonScalar(const glm::vec2 points[], size_t count,
+                        const AABB &bounds, uint32_t codes[]) {
+  glm::vec2 scale = getMortonScale(bounds);
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t x = quantizeMorton(points[i].x, bounds.min.x, scale.x);
+    uint32_t y = quantizeMorton(points[i].y, bounds.min.y, scale.y);
+    codes[i] = spreadMortonBits(x) | (spreadMortonBits(y) << 1);
+  }
+}
+
+#ifdef SIMD_X86
+__attribute__((target("bmi2"))) void
+encodeMortonBmi2(const glm::vec2 points[], size_t count, const AABB &bounds,
+                 uint32_t codes[]) {
+  glm::vec2 scale = getMortonScale(bounds);
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t x = quantizeMorton(points[i].x, bounds.min.x, scale.x);
+    uint32_t y = quantizeMorton(points[i].y, bounds.min.y, scale.y);
+    codes[i] = _pdep_u32(x, 0x55555555) | _pdep_u32(y, 0xAAAAAAAA);
+  }
+}
+
+__m128i spreadMortonBits(__m128i v) {
+  v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 8)),
+                    _mm_set1_epi32(0x00FF00FF));
+  v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 4)),
+                    _mm_set1_epi32(0x0F0F0F0F));
+  v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 2)),
+                    _mm_set1_epi32(0x33333333));
+  v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 1)),
+                    _mm_set1_epi32(0x55555555));
+  return v;
+}
+
+// Four points per iteration; SSE2 is always present on x86-64.
+void encodeMortonSse2(const glm::vec2 points[], size_t count,
+                      const AABB &bounds, uint32_t codes[]) {
+  glm::vec2 scale = getMortonScale(bounds);
+  __m128 minX = _mm_set1_ps(bounds.min.x), minY = _mm_set1_ps(bounds.min.y);
+  __m128 scaleX = _mm_set1_ps(scale.x), scaleY = _mm_set1_ps(scale.y);
+  __m128 zero = _mm_setzero_ps(), gridMax = _mm_set1_ps(MORTON_GRID_MAX);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const float *p = &points[i].x;
+    __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4);
+    __m128 x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(x, minX), scaleX), zero),
+                   gridMax);
+    y = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(y, minY), scaleY), zero),
+                   gridMax);
+    __m128i code =
+        _mm_or_si128(spreadMortonBits(_mm_cvttps_epi32(x)),
+                     _mm_slli_epi32(spreadMortonBits(_mm_cvttps_epi32(y)), 1));
+    _mm_storeu_si128((__m128i *)&codes[i], code);
+  }
+  encodeMortonScalar(points + i, count - i, bounds, codes + i);
+}
+#endif
+
+void encodeMorton2D(const glm::vec2 points[], size_t count,
+                    const AABB &bounds, uint32_t codes[]) {
+  parallelFor(count, MORTON_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+#ifdef SIMD_X86
+    if (cpuHasBmi2()) {
+      encodeMortonBmi2(points + begin, end - begin, bounds, codes + begin);
+    } else {
+      encodeMortonSse2(points + begin, end - begin, bounds, codes + begin);
+    }
+#else
+    encodeMortonScalar(points + begin, end - begin, bounds, codes + begin);
+#endif
+  });
+}
+
+void radixSortMorton(std::vector<uint32_t> &codes, std::vector<int> &values) {
+  size_t count = codes.size();
+  unsigned int threads = getParallelThreads(count, MORTON_MIN_PER_THREAD);
+  size_t chunk = (count + threads - 1) / threads;
+  std::vector<uint32_t> codeScratch(count);
+  std::vector<int> valueScratch(count);
+  std::vector<std::array<size_t, 256>> offsets(threads);
+
+  for (int shift = 0; shift < 32; shift += 8) {
+    parallelFor(threads, 1, [&](size_t begin, size_t end) {
+      for (size_t t = begin; t < end; ++t) {
+        std::array<size_t, 256> &histogram = offsets[t];
+        histogram.fill(0);
+        size_t last = std::min(count, (t + 1) * chunk);
+        for (size_t i = t * chunk; i < last; ++i) {
+          histogram[(codes[i] >> shift) & 0xFF]++;
+        }
+      }
+    });
+
+    // Thread t writes each digit after the same digit of threads before it,
+    // which keeps the sort stable.
+    size_t total = 0;
+    bool skip = false;
+    for (int digit = 0; digit < 256; ++digit) {
+      size_t digitCount = 0;
+      for (unsigned int t = 0; t < threads; ++t) {
+        size_t n = offsets[t][digit];
+        offsets[t][digit] = total + digitCount;
+        digitCount += n;
+      }
+      skip = skip || digitCount == count;
+      total += digitCount;
+    }
+    if (skip) {
+      continue;
+    }
+
+    parallelFor(threads, 1, [&](size_t begin, size_t end) {
+      for (size_t t = begin; t < end; ++t) {
+        std::array<size_t, 256> &offset = offsets[t];
+        size_t last = std::min(count, (t + 1) * chunk);
+        for (size_t i = t * chunk; i < last; ++i) {
+          size_t target = offset[(codes[i] >> shift) & 0xFF]++;
+          codeScratch[target] = codes[i];
+          valueScratch[target] = values[i];
+        }
+      }
+    });
+    codes.swap(codeScratch);
+    values.swap(valueScratch);
+  }
+}
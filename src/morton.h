@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "bvh.h"
+
+// Quantizes points to a 16-bit grid over bounds and interleaves the grid
+// coordinates into 32-bit Morton codes, x in the even bits, matching
+// glm::bitfieldInterleave(uint16, uint16). Uses BMI2 pdep where available
+// and an SSE2 bit-spreading path otherwise.
+void encodeMorton2D(const glm::vec2 points[], size_t count,
+                    const AABB &bounds, uint32_t codes[]);
+
+// Sorts codes ascending and applies the same permutation to values. LSD
+// radix sort with 8-bit digits; histograms and scatters run in parallel and
+// digits that are equal across all keys are skipped.
+void radixSortMorton(std::vector<uint32_t> &codes, std::vector<int> &values);
@@ -0,0 +1,190 @@
+#include "normalize.h"
+
+#include <cmath>
+
+#include "parallel.h"
+#include "simd.h"
+
+const size_t NORMALIZE_MIN_PER_THREAD = 1 << 16;
+
+const char *getNormalizeModeName(NormalizeMode mode) {
+  switch (mode) {
+  case NORMALIZE_FAST:
+    return "fast";
+  case NORMALIZE_REFINED:
+    return "refined";
+  case NORMALIZE_EXACT:
+    return "exact";
+  }
+  return "unknown";
+}
+
+// Scalar inverse length with the same accuracy as the vector kernels.
+float getInverseLength(float lengthSquared, NormalizeMode mode) {
+  if (mode == NORMALIZE_EXACT) {
+    return 1.0f / std::sqrt(lengthSquared);
+  }
+#ifdef SIMD_X86
+  float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(lengthSquared)));
+  if (mode == NORMALIZE_REFINED) {
+    y = y * (1.5f - 0.5f * lengthSquared * y * y);
+  }
+  return y;
+#else
+  return 1.0f / std::sqrt(lengthSquared);
+#endif
+}
+
+template <typename Vector>
+void normalizeScalar(const Vector in[], Vector out[], size_t begin,
+                     size_t end, NormalizeMode mode) {
+  for (size_t i = begin; i < end; ++i) {
+    out[i] = in[i] * getInverseLength(glm::dot(in[i], in[i]), mode);
+  }
+}
+
+#ifdef SIMD_X86
+// Multiplies v by 1 / sqrt(lengthSquared) at the requested accuracy.
+SIMD_AVX2 __m256 scaleLanes(__m256 v, __m256 lengthSquared,
+                            NormalizeMode mode) {
+  if (mode == NORMALIZE_EXACT) {
+    return _mm256_div_ps(v, _mm256_sqrt_ps(lengthSquared));
+  }
+  __m256 y = _mm256_rsqrt_ps(lengthSquared);
+  if (mode == NORMALIZE_REFINED) {
+    // y (1.5 - 0.5 l y^2), written so the last step rounds once.
+    __m256 halfY = _mm256_mul_ps(y, _mm256_set1_ps(0.5f));
+    __m256 e = _mm256_fnmadd_ps(_mm256_mul_ps(lengthSquared, y), y,
+                                _mm256_set1_ps(3.0f));
+    y = _mm256_mul_ps(halfY, e);
+  }
+  return _mm256_mul_ps(v, y);
+}
+
+SIMD_AVX2 size_t normalizeAvx2(const glm::vec2 in[], glm::vec2 out[],
+                               size_t count, NormalizeMode mode) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256 v = _mm256_loadu_ps(&in[i].x);
+    __m256 square = _mm256_mul_ps(v, v);
+    __m256 swapped = _mm256_permute_ps(square, _MM_SHUFFLE(2, 3, 0, 1));
+    __m256 length = _mm256_add_ps(square, swapped);
+    _mm256_storeu_ps(&out[i].x, scaleLanes(v, length, mode));
+  }
+  return i;
+}
+
+SIMD_AVX2 size_t normalizeAvx2(const glm::vec3 in[], glm::vec3 out[],
+                               size_t count, NormalizeMode mode) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 v[3];
+    loadVec3Lanes(&in[i].x, v);
+    __m256 length = dotLanes(v, v);
+    if (mode == NORMALIZE_EXACT) {
+      __m256 root = _mm256_sqrt_ps(length);
+      for (int d = 0; d < 3; ++d) {
+        v[d] = _mm256_div_ps(v[d], root);
+      }
+    } else {
+      __m256 scale = scaleLanes(_mm256_set1_ps(1.0f), length, mode);
+      for (int d = 0; d < 3; ++d) {
+        v[d] = _mm256_mul_ps(v[d], scale);
+      }
+    }
+    storeVec3Lanes(&out[i].x, v);
+  }
+  return i;
+}
+
+SIMD_AVX2 size_t normalizeAvx2(const glm::vec4 in[], glm::vec4 out[],
+                               size_t count, NormalizeMode mode) {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m256 v = _mm256_loadu_ps(&in[i].x);
+    __m256 square = _mm256_mul_ps(v, v);
+    // Two horizontal adds leave each vector's sum in all four of its lanes.
+    __m256 pairs = _mm256_hadd_ps(square, square);
+    __m256 length = _mm256_hadd_ps(pairs, pairs);
+    _mm256_storeu_ps(&out[i].x, scaleLanes(v, length, mode));
+  }
+  return i;
+}
+
+SIMD_AVX2 size_t normalizeArraysAvx2(float *const components[], int dimension,
+                                     size_t begin, size_t end,
+                                     NormalizeMode mode) {
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 v[4];
+    __m256 length = _mm256_setzero_ps();
+    for (int d = 0; d < dimension; ++d) {
+      v[d] = _mm256_loadu_ps(components[d] + i);
+      length = _mm256_fmadd_ps(v[d], v[d], length);
+    }
+    if (mode == NORMALIZE_EXACT) {
+      __m256 root = _mm256_sqrt_ps(length);
+      for (int d = 0; d < dimension; ++d) {
+        _mm256_storeu_ps(components[d] + i, _mm256_div_ps(v[d], root));
+      }
+    } else {
+      __m256 scale = scaleLanes(_mm256_set1_ps(1.0f), length, mode);
+      for (int d = 0; d < dimension; ++d) {
+        _mm256_storeu_ps(components[d] + i, _mm256_mul_ps(v[d], scale));
+      }
+    }
+  }
+  return i;
+}
+#endif
+
+template <typename Vector>
+void normalizeBatch(const Vector in[], Vector out[], size_t count,
+                    NormalizeMode mode) {
+  parallelFor(count, NORMALIZE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      i += normalizeAvx2(in + begin, out + begin, end - begin, mode);
+    }
+#endif
+    normalizeScalar(in, out, i, end, mode);
+  });
+}
+
+void normalizeVectors(const glm::vec2 in[], glm::vec2 out[], size_t count,
+                      NormalizeMode mode) {
+  normalizeBatch(in, out, count, mode);
+}
+
+void normalizeVectors(const glm::vec3 in[], glm::vec3 out[], size_t count,
+                      NormalizeMode mode) {
+  normalizeBatch(in, out, count, mode);
+}
+
+void normalizeVectors(const glm::vec4 in[], glm::vec4 out[], size_t count,
+                      NormalizeMode mode) {
+  normalizeBatch(in, out, count, mode);
+}
+
+void normalizeArrays(float *const components[], int dimension, size_t count,
+                     NormalizeMode mode) {
+  parallelFor(count, NORMALIZE_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    size_t i = begin;
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      i = normalizeArraysAvx2(components, dimension, begin, end, mode);
+    }
+#endif
+    for (; i < end; ++i) {
+      float length = 0.0f;
+      for (int d = 0; d < dimension; ++d) {
+        length += components[d][i] * components[d][i];
+      }
+      float scale = getInverseLength(length, mode);
+      for (int d = 0; d < dimension; ++d) {
+        components[d][i] *= scale;
+      }
+    }
+  });
+}
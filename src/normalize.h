@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Accuracy of the inverse length used by the normalize kernels.
+enum NormalizeMode {
+  // rsqrtps alone, about 12 bits.
+  NORMALIZE_FAST,
+  // rsqrtps and one Newton-Raphson step, within 5 ulp.
+  NORMALIZE_REFINED,
+  // sqrt and divide, within 3 ulp like glm::normalize.
+  NORMALIZE_EXACT
+};
+
+const char *getNormalizeModeName(NormalizeMode mode);
+
+// Normalizes count vectors stored as whole vectors (AoS). AVX2/FMA with a
+// scalar fallback at the same accuracy, split across threads for large
+// inputs. out may alias in. Zero vectors give NaN, as glm::normalize does.
+void normalizeVectors(const glm::vec2 in[], glm::vec2 out[], size_t count,
+                      NormalizeMode mode);
+void normalizeVectors(const glm::vec3 in[], glm::vec3 out[], size_t count,
+                      NormalizeMode mode);
+void normalizeVectors(const glm::vec4 in[], glm::vec4 out[], size_t count,
+                      NormalizeMode mode);
+
+// Normalizes in place count vectors stored as dimension (2 to 4) separate
+// component arrays (SoA).
+void normalizeArrays(float *const components[], int dimension, size_t count,
+                     NormalizeMode mode);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of threads for count items, so that none gets fewer than
+// minPerThread.
+inline unsigned int getParallelThreads(size_t count, size_t minPerThread) {
+  // hardware_concurrency() reads sysfs on glibc, which costs microseconds.
+  static const unsigned int cores =
+      std::max(1u, std::thread::hardware_concurrency());
+  return std::max<size_t>(1, std::min<size_t>(cores, count / minPerThread));
+}
+
+// Calls fn(begin, end) on contiguous chunks of [0, count), one per thread.
+// Inputs too small to split run inline on the calling thread.
+//
+// Threads are started per call instead of borrowed from a JobSystem.
+// minPerThread keeps each thread's share well above the tens of
+// microseconds a start costs. The kernels can then be called from inside
+// JobSystem jobs, which would deadlock waiting on their own busy pool, and
+// from tools that have no pool.
+template <typename F>
+void parallelFor(size_t count, size_t minPerThread, const F &fn) {
+  unsigned int threads = getParallelThreads(count, minPerThread);
+  size_t chunk = (count + threads - 1) / threads;
+  std::vector<std::thread> workers;
+  for (unsigned int t = 1; t < threads; ++t) {
+    size_t begin = t * chunk;
+    size_t end = std::min(count, begin + chunk);
+    if (begin < end) {
+      workers.emplace_back([&fn, begin, end] { fn(begin, end); });
+    }
+  }
+  fn(0, std::min(count, chunk));
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
@@ -0,0 +1,72 @@
+#include "procedural_batch.h"
+
+#ifndef BUFFER_OFFSET
+#define BUFFER_OFFSET(offset) ((GLvoid *)(offset))
+#endif
+
+AABB getPolygonBounds(const PolygonParams &polygon) {
+  AABB box;
+  box.min = polygon.center - polygon.radius;
+  box.max = polygon.center + polygon.radius;
+  return box;
+}
+
+void ProceduralBatch::add(const PolygonParams &polygon) {
+  if (polygon.segments < 3) {
+    return;
+  }
+
+  // gl_VertexID runs over the unrolled fan; the base instance selects the
+  // polygon record.
+  DrawArraysIndirectCommand command;
+  command.count = 3 * (polygon.segments - 2);
+  command.instanceCount = 1;
+  command.first = 0;
+  command.baseInstance = polygons.size();
+  commands.push_back(command);
+
+  polygons.push_back(polygon);
+}
+
+void ProceduralBatch::upload() {
+  // Core profile still requires a bound VAO, even with no attributes.
+  glGenVertexArrays(1, &vao);
+
+  glGenBuffers(1, &polygonBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, polygonBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER,
+               polygons.size() * sizeof(PolygonParams), polygons.data(),
+               GL_STATIC_DRAW);
+
+  glGenBuffers(1, &indirectBuffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER,
+               commands.size() * sizeof(DrawArraysIndirectCommand),
+               commands.data(), GL_DYNAMIC_DRAW);
+  drawCount = commands.size();
+}
+
+void ProceduralBatch::setVisible(const std::vector<int> &visible) {
+  visibleCommands.clear();
+  for (int index : visible) {
+    visibleCommands.push_back(commands[index]);
+  }
+  drawCount = visibleCommands.size();
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+                  drawCount * sizeof(DrawArraysIndirectCommand),
+                  visibleCommands.data());
+}
+
+void ProceduralBatch::draw() const {
+  if (drawCount == 0) {
+    return;
+  }
+
+  glBindVertexArray(vao);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POLYGON_BUFFER_BINDING,
+                   polygonBuffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+  glMultiDrawArraysIndirect(GL_TRIANGLES, BUFFER_OFFSET(0), drawCount, 0);
+}
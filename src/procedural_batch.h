@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "bvh.h"
+#include "shape_batch.h"
+
+enum ColorRule { COLOR_SOLID, COLOR_ANGLE, COLOR_CORNERS };
+
+// Per-polygon record read by shaders/vertex_shader_procedural.glsl. The
+// vertex at angle startAngle + 2 * pi * k / segments is
+// center + (sin, cos) * radius, which covers the circles, ellipses, squares
+// and triangle of task2. Layout matches std430.
+struct PolygonParams {
+  glm::vec2 center;
+  glm::vec2 radius;
+  float startAngle;
+  GLuint segments;
+  GLuint colorRule;
+  GLuint shapeIndex;
+  glm::vec4 color;
+};
+
+const GLuint POLYGON_BUFFER_BINDING = 1;
+
+AABB getPolygonBounds(const PolygonParams &polygon);
+
+// Draws polygons whose vertices are derived from gl_VertexID in the vertex
+// shader. Only the parameter records and indirect commands are uploaded.
+class ProceduralBatch {
+public:
+  void add(const PolygonParams &polygon);
+
+  void upload();
+  void setVisible(const std::vector<int> &visible);
+  void draw() const;
+
+  int commandCount() const { return commands.size(); }
+  int visibleCount() const { return drawCount; }
+
+private:
+  std::vector<PolygonParams> polygons;
+  std::vector<DrawArraysIndirectCommand> commands;
+  std::vector<DrawArraysIndirectCommand> visibleCommands;
+  int drawCount = 0;
+
+  GLuint vao = 0;
+  GLuint polygonBuffer = 0;
+  GLuint indirectBuffer = 0;
+};
@@ -0,0 +1,316 @@
+#include "quat_batch.h"
+
+#include <vector>
+
+#include "parallel.h"
+#include "simd.h"
+
+const size_t QUAT_MIN_PER_THREAD = 1 << 14;
+
+// Coefficients of Eberly's slerp polynomial with eight terms; the last
+// pair is scaled by mu to balance the truncation error.
+const float SLERP_MU = 1.85298109240830f;
+const float SLERP_U[8] = {1.0f / (1 * 3),  1.0f / (2 * 5),  1.0f / (3 * 7),
+                          1.0f / (4 * 9),  1.0f / (5 * 11), 1.0f / (6 * 13),
+                          1.0f / (7 * 15), SLERP_MU / (8 * 17)};
+const float SLERP_V[8] = {1.0f / 3,  2.0f / 5,  3.0f / 7,
+                          4.0f / 9,  5.0f / 11, 6.0f / 13,
+                          7.0f / 15, SLERP_MU * 8 / 17};
+
+glm::quat loadQuat(const QuatArrays &q, size_t i) {
+  return glm::quat(q.w[i], q.x[i], q.y[i], q.z[i]);
+}
+
+void storeQuat(const QuatArrays &q, size_t i, const glm::quat &value) {
+  q.x[i] = value.x;
+  q.y[i] = value.y;
+  q.z[i] = value.z;
+  q.w[i] = value.w;
+}
+
+void nlerpQuatsScalar(const QuatArrays &a, const QuatArrays &b,
+                      const float t[], const QuatArrays &out, size_t begin,
+                      size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    glm::quat qa = loadQuat(a, i), qb = loadQuat(b, i);
+    float tb = glm::dot(qa, qb) < 0.0f ? -t[i] : t[i];
+    storeQuat(out, i, glm::normalize(qa * (1.0f - t[i]) + qb * tb));
+  }
+}
+
+float getSlerpWeight(float t, float xm1) {
+  float sqrT = t * t;
+  float f = 1.0f;
+  for (int i = 7; i >= 0; --i) {
+    f = 1.0f + (SLERP_U[i] * sqrT - SLERP_V[i]) * xm1 * f;
+  }
+  return t * f;
+}
+
+void slerpQuatsScalar(const QuatArrays &a, const QuatArrays &b,
+                      const float t[], const QuatArrays &out, size_t begin,
+                      size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    glm::quat qa = loadQuat(a, i), qb = loadQuat(b, i);
+    float x = glm::dot(qa, qb);
+    float sign = x < 0.0f ? -1.0f : 1.0f;
+    float xm1 = x * sign - 1.0f;
+    float wa = getSlerpWeight(1.0f - t[i], xm1);
+    float wb = getSlerpWeight(t[i], xm1) * sign;
+    storeQuat(out, i, qa * wa + qb * wb);
+  }
+}
+
+#ifdef SIMD_X86
+struct QuatLanes {
+  __m256 x, y, z, w;
+};
+
+SIMD_AVX2 QuatLanes loadQuatLanes(const QuatArrays &q, size_t i) {
+  return {_mm256_loadu_ps(q.x + i), _mm256_loadu_ps(q.y + i),
+          _mm256_loadu_ps(q.z + i), _mm256_loadu_ps(q.w + i)};
+}
+
+SIMD_AVX2 void storeQuatLanes(const QuatArrays &q, size_t i,
+                              const QuatLanes &v) {
+  _mm256_storeu_ps(q.x + i, v.x);
+  _mm256_storeu_ps(q.y + i, v.y);
+  _mm256_storeu_ps(q.z + i, v.z);
+  _mm256_storeu_ps(q.w + i, v.w);
+}
+
+SIMD_AVX2 __m256 dotQuatLanes(const QuatLanes &a, const QuatLanes &b) {
+  __m256 d = _mm256_mul_ps(a.x, b.x);
+  d = _mm256_fmadd_ps(a.y, b.y, d);
+  d = _mm256_fmadd_ps(a.z, b.z, d);
+  return _mm256_fmadd_ps(a.w, b.w, d);
+}
+
+SIMD_AVX2 QuatLanes mixQuatLanes(const QuatLanes &a, __m256 wa,
+                                 const QuatLanes &b, __m256 wb) {
+  return {_mm256_fmadd_ps(b.x, wb, _mm256_mul_ps(a.x, wa)),
+          _mm256_fmadd_ps(b.y, wb, _mm256_mul_ps(a.y, wa)),
+          _mm256_fmadd_ps(b.z, wb, _mm256_mul_ps(a.z, wa)),
+          _mm256_fmadd_ps(b.w, wb, _mm256_mul_ps(a.w, wa))};
+}
+
+// rsqrt refined by one Newton step, good to about 2 ulp.
+SIMD_AVX2 __m256 rsqrtLanes(__m256 x) {
+  __m256 y = _mm256_rsqrt_ps(x);
+  __m256 halfX = _mm256_mul_ps(x, _mm256_set1_ps(0.5f));
+  __m256 r =
+      _mm256_fnmadd_ps(halfX, _mm256_mul_ps(y, y), _mm256_set1_ps(1.5f));
+  return _mm256_mul_ps(y, r);
+}
+
+SIMD_AVX2 void nlerpQuatsAvx2(const QuatArrays &a, const QuatArrays &b,
+                              const float t[], const QuatArrays &out,
+                              size_t begin, size_t end) {
+  __m256 signMask = _mm256_set1_ps(-0.0f), one = _mm256_set1_ps(1.0f);
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    QuatLanes qa = loadQuatLanes(a, i), qb = loadQuatLanes(b, i);
+    __m256 ti = _mm256_loadu_ps(t + i);
+    __m256 sign = _mm256_and_ps(dotQuatLanes(qa, qb), signMask);
+    QuatLanes q = mixQuatLanes(qa, _mm256_sub_ps(one, ti), qb,
+                               _mm256_xor_ps(ti, sign));
+    __m256 scale = rsqrtLanes(dotQuatLanes(q, q));
+    q.x = _mm256_mul_ps(q.x, scale);
+    q.y = _mm256_mul_ps(q.y, scale);
+    q.z = _mm256_mul_ps(q.z, scale);
+    q.w = _mm256_mul_ps(q.w, scale);
+    storeQuatLanes(out, i, q);
+  }
+  nlerpQuatsScalar(a, b, t, out, i, end);
+}
+
+SIMD_AVX2 __m256 getSlerpWeightLanes(__m256 t, __m256 xm1) {
+  __m256 sqrT = _mm256_mul_ps(t, t), one = _mm256_set1_ps(1.0f);
+  __m256 f = one;
+  for (int i = 7; i >= 0; --i) {
+    __m256 b = _mm256_fmsub_ps(_mm256_set1_ps(SLERP_U[i]), sqrT,
+                               _mm256_set1_ps(SLERP_V[i]));
+    f = _mm256_fmadd_ps(_mm256_mul_ps(b, xm1), f, one);
+  }
+  return _mm256_mul_ps(t, f);
+}
+
+SIMD_AVX2 void slerpQuatsAvx2(const QuatArrays &a, const QuatArrays &b,
+                              const float t[], const QuatArrays &out,
+                              size_t begin, size_t end) {
+  __m256 signMask = _mm256_set1_ps(-0.0f), one = _mm256_set1_ps(1.0f);
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    QuatLanes qa = loadQuatLanes(a, i), qb = loadQuatLanes(b, i);
+    __m256 ti = _mm256_loadu_ps(t + i);
+    __m256 x = dotQuatLanes(qa, qb);
+    __m256 sign = _mm256_and_ps(x, signMask);
+    __m256 xm1 = _mm256_sub_ps(_mm256_andnot_ps(signMask, x), one);
+    __m256 wa = getSlerpWeightLanes(_mm256_sub_ps(one, ti), xm1);
+    __m256 wb = _mm256_xor_ps(getSlerpWeightLanes(ti, xm1), sign);
+    storeQuatLanes(out, i, mixQuatLanes(qa, wa, qb, wb));
+  }
+  slerpQuatsScalar(a, b, t, out, i, end);
+}
+#endif
+
+void nlerpQuats(const QuatArrays &a, const QuatArrays &b, const float t[],
+                const QuatArrays &out, size_t count) {
+  parallelFor(count, QUAT_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      nlerpQuatsAvx2(a, b, t, out, begin, end);
+      return;
+    }
+#endif
+    nlerpQuatsScalar(a, b, t, out, begin, end);
+  });
+}
+
+void slerpQuats(const QuatArrays &a, const QuatArrays &b, const float t[],
+                const QuatArrays &out, size_t count) {
+  parallelFor(count, QUAT_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+#ifdef SIMD_X86
+    if (cpuHasAvx2()) {
+      slerpQuatsAvx2(a, b, t, out, begin, end);
+      return;
+    }
+#endif
+    slerpQuatsScalar(a, b, t, out, begin, end);
+  });
+}
+
+SkinBone makeSkinBone(const glm::quat &rotation,
+                      const glm::vec3 &translation) {
+  glm::quat t(0.0f, translation.x, translation.y, translation.z);
+  return {rotation, t * rotation * 0.5f};
+}
+
+void skinDualQuatScalar(const SkinBone bones[], const glm::vec3 positions[],
+                        const glm::ivec4 joints[], const glm::vec4 weights[],
+                        size_t begin, size_t end, glm::vec3 out[]) {
+  for (size_t i = begin; i < end; ++i) {
+    const glm::quat &pivot = bones[joints[i][0]].real;
+    glm::quat real(0.0f, 0.0f, 0.0f, 0.0f), dual(0.0f, 0.0f, 0.0f, 0.0f);
+    for (int k = 0; k < 4; ++k) {
+      const SkinBone &bone = bones[joints[i][k]];
+      float w = weights[i][k];
+      if (glm::dot(bone.real, pivot) < 0.0f) {
+        w = -w;
+      }
+      real = real + bone.real * w;
+      dual = dual + bone.dual * w;
+    }
+    float scale = 1.0f / glm::length(real);
+    glm::vec3 r(real.x, real.y, real.z), d(dual.x, dual.y, dual.z);
+    r *= scale;
+    d *= scale;
+    float rw = real.w * scale, dw = dual.w * scale;
+    glm::vec3 p = positions[i];
+    p += 2.0f * glm::cross(r, glm::cross(r, p) + rw * p);
+    out[i] = p + 2.0f * (rw * d - dw * r + glm::cross(r, d));
+  }
+}
+
+#ifdef SIMD_X86
+// bones holds the eight dual quaternion components as separate arrays of
+// boneCount floats: real x, y, z, w, then dual x, y, z, w. Returns where
+// the scalar path has to take over.
+SIMD_AVX2 size_t skinDualQuatAvx2(const float bones[], size_t boneCount,
+                                  const glm::vec3 positions[],
+                                  const glm::ivec4 joints[],
+                                  const glm::vec4 weights[], size_t begin,
+                                  size_t end, glm::vec3 out[]) {
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i lane4 = _mm256_slli_epi32(lane, 2);
+  const __m256 signMask = _mm256_set1_ps(-0.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    const int *jointBase = &joints[i].x;
+    const float *weightBase = &weights[i].x;
+    __m256 blend[8];
+    __m256i pivot = _mm256_i32gather_epi32(jointBase, lane4, 4);
+    __m256 pivotReal[4];
+    for (int c = 0; c < 4; ++c) {
+      pivotReal[c] = _mm256_i32gather_ps(bones + c * boneCount, pivot, 4);
+    }
+    for (int c = 0; c < 8; ++c) {
+      blend[c] = _mm256_setzero_ps();
+    }
+    for (int k = 0; k < 4; ++k) {
+      __m256i offset = _mm256_add_epi32(lane4, _mm256_set1_epi32(k));
+      __m256i joint = _mm256_i32gather_epi32(jointBase, offset, 4);
+      __m256 w = _mm256_i32gather_ps(weightBase, offset, 4);
+      __m256 bone[8];
+      for (int c = 0; c < 8; ++c) {
+        bone[c] = _mm256_i32gather_ps(bones + c * boneCount, joint, 4);
+      }
+      __m256 hemisphere = _mm256_mul_ps(bone[0], pivotReal[0]);
+      for (int c = 1; c < 4; ++c) {
+        hemisphere = _mm256_fmadd_ps(bone[c], pivotReal[c], hemisphere);
+      }
+      w = _mm256_xor_ps(w, _mm256_and_ps(hemisphere, signMask));
+      for (int c = 0; c < 8; ++c) {
+        blend[c] = _mm256_fmadd_ps(bone[c], w, blend[c]);
+      }
+    }
+
+    __m256 length = _mm256_mul_ps(blend[0], blend[0]);
+    for (int c = 1; c < 4; ++c) {
+      length = _mm256_fmadd_ps(blend[c], blend[c], length);
+    }
+    __m256 scale = rsqrtLanes(length);
+    for (int c = 0; c < 8; ++c) {
+      blend[c] = _mm256_mul_ps(blend[c], scale);
+    }
+    __m256 *r = blend, *d = blend + 4;
+    __m256 rw = blend[3], dw = blend[7];
+    __m256 p[3];
+    loadVec3Lanes(&positions[i].x, p);
+
+    // p + 2 r x (r x p + rw p) + 2 (rw d - dw r + r x d)
+    __m256 rp[3], rotated[3], rd[3];
+    crossLanes(r, p, rp);
+    for (int c = 0; c < 3; ++c) {
+      rp[c] = _mm256_fmadd_ps(rw, p[c], rp[c]);
+    }
+    crossLanes(r, rp, rotated);
+    crossLanes(r, d, rd);
+    for (int c = 0; c < 3; ++c) {
+      __m256 t = _mm256_fnmadd_ps(dw, r[c], _mm256_fmadd_ps(rw, d[c], rd[c]));
+      p[c] = _mm256_fmadd_ps(two, _mm256_add_ps(rotated[c], t), p[c]);
+    }
+    storeVec3Lanes(&out[i].x, p);
+  }
+  return i;
+}
+#endif
+
+void skinDualQuat(const SkinBone bones[], size_t boneCount,
+                  const glm::vec3 positions[], const glm::ivec4 joints[],
+                  const glm::vec4 weights[], size_t count, glm::vec3 out[]) {
+#ifdef SIMD_X86
+  if (cpuHasAvx2()) {
+    std::vector<float> table(8 * boneCount);
+    for (size_t j = 0; j < boneCount; ++j) {
+      const float components[8] = {
+          bones[j].real.x, bones[j].real.y, bones[j].real.z, bones[j].real.w,
+          bones[j].dual.x, bones[j].dual.y, bones[j].dual.z, bones[j].dual.w};
+      for (int c = 0; c < 8; ++c) {
+        table[c * boneCount + j] = components[c];
+      }
+    }
+    parallelFor(count, QUAT_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+      size_t i = skinDualQuatAvx2(table.data(), boneCount, positions,
+                                  joints, weights, begin, end, out);
+      skinDualQuatScalar(bones, positions, joints, weights, i, end, out);
+    });
+    return;
+  }
+#endif
+  parallelFor(count, QUAT_MIN_PER_THREAD, [&](size_t begin, size_t end) {
+    skinDualQuatScalar(bones, positions, joints, weights, begin, end, out);
+  });
+}
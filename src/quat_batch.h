@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Quaternions stored as separate component arrays of equal length, so
+// kernels can load eight of each component at once.
+struct QuatArrays {
+  float *x;
+  float *y;
+  float *z;
+  float *w;
+};
+
+// out[i] = normalize(mix(a[i], b[i], t[i])) along the shorter arc. out may
+// alias a or b.
+void nlerpQuats(const QuatArrays &a, const QuatArrays &b, const float t[],
+                const QuatArrays &out, size_t count);
+
+// out[i] = slerp(a[i], b[i], t[i]) along the shorter arc, without acos or
+// sin: the slerp weights come from a polynomial in cos(angle) (Eberly,
+// "A Fast and Accurate Algorithm for Computing SLERP"). Components are
+// within 3e-5 of the exact slerp over the whole range; nlerp is cheaper
+// but drifts up to 0.07. Inputs must be unit quaternions. out may alias a
+// or b.
+void slerpQuats(const QuatArrays &a, const QuatArrays &b, const float t[],
+                const QuatArrays &out, size_t count);
+
+// A rigid bone transform as a unit dual quaternion.
+struct SkinBone {
+  glm::quat real;
+  glm::quat dual;
+};
+
+// The bone that rotates by rotation and then translates by translation.
+SkinBone makeSkinBone(const glm::quat &rotation, const glm::vec3 &translation);
+
+// Dual quaternion linear-blend skinning with four influences per vertex:
+// out[i] is positions[i] moved by the normalized blend of
+// bones[joints[i][k]] weighted by weights[i][k]. Bones whose real part is
+// on the other hemisphere from the first influence are negated so the
+// blend takes the short path.
+void skinDualQuat(const SkinBone bones[], size_t boneCount,
+                  const glm::vec3 positions[], const glm::ivec4 joints[],
+                  const glm::vec4 weights[], size_t count, glm::vec3 out[]);
@@ -0,0 +1,177 @@
+#include "reduce.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#include "parallel.h"
+#include "simd.h"
+
+const size_t REDUCE_MIN_PER_THREAD = 1 << 16;
+
+// Floats per AVX2 step: a whole number of vectors for every dimension, so
+// float k of a step always belongs to component k % dimension.
+const size_t REDUCE_STEP = 24;
+
+#ifdef SIMD_X86
+// Folds min and max over count vectors into min and max. Returns how many
+// vectors were done.
+SIMD_AVX2 size_t minMaxAvx2(const float data[], size_t count, int dimension,
+                            float min[], float max[]) {
+  size_t floats = count * dimension;
+  __m256 low[3], high[3];
+  for (int r = 0; r < 3; ++r) {
+    low[r] = _mm256_set1_ps(FLT_MAX);
+    high[r] = _mm256_set1_ps(-FLT_MAX);
+  }
+  size_t i = 0;
+  for (; i + REDUCE_STEP <= floats; i += REDUCE_STEP) {
+    for (int r = 0; r < 3; ++r) {
+      __m256 v = _mm256_loadu_ps(data + i + r * 8);
+      low[r] = _mm256_min_ps(low[r], v);
+      high[r] = _mm256_max_ps(high[r], v);
+    }
+  }
+  float lows[REDUCE_STEP], highs[REDUCE_STEP];
+  for (int r = 0; r < 3; ++r) {
+    _mm256_storeu_ps(lows + r * 8, low[r]);
+    _mm256_storeu_ps(highs + r * 8, high[r]);
+  }
+  // Unoptimized builds call std::min as SSE code; clean upper halves keep
+  // those calls free of AVX/SSE transition stalls.
+  _mm256_zeroupper();
+  for (size_t k = 0; k < REDUCE_STEP; ++k) {
+    min[k % dimension] = std::min(min[k % dimension], lows[k]);
+    max[k % dimension] = std::max(max[k % dimension], highs[k]);
+  }
+  return i / dimension;
+}
+
+// Adds count vectors into sum, widening each half register to double.
+SIMD_AVX2 size_t sumAvx2(const float data[], size_t count, int dimension,
+                         double sum[]) {
+  size_t floats = count * dimension;
+  __m256d total[6];
+  for (int r = 0; r < 6; ++r) {
+    total[r] = _mm256_setzero_pd();
+  }
+  size_t i = 0;
+  for (; i + REDUCE_STEP <= floats; i += REDUCE_STEP) {
+    for (int r = 0; r < 3; ++r) {
+      __m256 v = _mm256_loadu_ps(data + i + r * 8);
+      total[r * 2] = _mm256_add_pd(
+          total[r * 2], _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+      total[r * 2 + 1] = _mm256_add_pd(
+          total[r * 2 + 1], _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+  }
+  double totals[REDUCE_STEP];
+  for (int r = 0; r < 6; ++r) {
+    _mm256_storeu_pd(totals + r * 4, total[r]);
+  }
+  _mm256_zeroupper();
+  for (size_t k = 0; k < REDUCE_STEP; ++k) {
+    sum[k % dimension] += totals[k];
+  }
+  return i / dimension;
+}
+#endif
+
+// Calls reduce(begin, end, partial) on one chunk of [0, count) per thread,
+// each with its own width values starting at initial, and returns the
+// partials one after another.
+template <typename T, typename F>
+std::vector<T> reduceChunks(size_t count, int width, T initial,
+                            const F &reduce) {
+  unsigned int threads = getParallelThreads(count, REDUCE_MIN_PER_THREAD);
+  size_t chunk = (count + threads - 1) / threads;
+  std::vector<T> partials(threads * width, initial);
+  parallelFor(threads, 1, [&](size_t begin, size_t end) {
+    for (size_t t = begin; t < end; ++t) {
+      reduce(std::min(count, t * chunk), std::min(count, (t + 1) * chunk),
+             &partials[t * width]);
+    }
+  });
+  return partials;
+}
+
+// Folds vectors [begin, end) into low and high. The AVX2 kernel only runs
+// when it gets at least one whole step.
+void minMaxRange(const float data[], int dimension, size_t begin, size_t end,
+                 float low[], float high[]) {
+  size_t i = begin;
+#ifdef SIMD_X86
+  if (cpuHasAvx2() && (end - begin) * dimension >= REDUCE_STEP) {
+    i += minMaxAvx2(data + begin * dimension, end - begin, dimension, low,
+                    high);
+  }
+#endif
+  for (; i < end; ++i) {
+    for (int d = 0; d < dimension; ++d) {
+      low[d] = std::min(low[d], data[i * dimension + d]);
+      high[d] = std::max(high[d], data[i * dimension + d]);
+    }
+  }
+}
+
+// Adds vectors [begin, end) into total.
+void sumRange(const float data[], int dimension, size_t begin, size_t end,
+              double total[]) {
+  size_t i = begin;
+#ifdef SIMD_X86
+  if (cpuHasAvx2() && (end - begin) * dimension >= REDUCE_STEP) {
+    i += sumAvx2(data + begin * dimension, end - begin, dimension, total);
+  }
+#endif
+  for (; i < end; ++i) {
+    for (int d = 0; d < dimension; ++d) {
+      total[d] += data[i * dimension + d];
+    }
+  }
+}
+
+// Inputs that one thread handles skip the partials, so reducing a few
+// vertices costs no more than a plain loop.
+
+void reduceMinMax(const float data[], size_t count, int dimension,
+                  float min[], float max[]) {
+  std::fill(min, min + dimension, FLT_MAX);
+  std::fill(max, max + dimension, -FLT_MAX);
+  if (getParallelThreads(count, REDUCE_MIN_PER_THREAD) == 1) {
+    minMaxRange(data, dimension, 0, count, min, max);
+    return;
+  }
+
+  // Each chunk writes its minimums followed by its maximums.
+  std::vector<float> partials = reduceChunks(
+      count, dimension * 2, FLT_MAX,
+      [&](size_t begin, size_t end, float bounds[]) {
+        std::fill(bounds + dimension, bounds + dimension * 2, -FLT_MAX);
+        minMaxRange(data, dimension, begin, end, bounds, bounds + dimension);
+      });
+  for (size_t k = 0; k < partials.size(); ++k) {
+    int d = k % (dimension * 2);
+    if (d < dimension) {
+      min[d] = std::min(min[d], partials[k]);
+    } else {
+      max[d - dimension] = std::max(max[d - dimension], partials[k]);
+    }
+  }
+}
+
+void reduceSum(const float data[], size_t count, int dimension,
+               double sum[]) {
+  std::fill(sum, sum + dimension, 0.0);
+  if (getParallelThreads(count, REDUCE_MIN_PER_THREAD) == 1) {
+    sumRange(data, dimension, 0, count, sum);
+    return;
+  }
+
+  std::vector<double> partials = reduceChunks(
+      count, dimension, 0.0, [&](size_t begin, size_t end, double total[]) {
+        sumRange(data, dimension, begin, end, total);
+      });
+  for (size_t k = 0; k < partials.size(); ++k) {
+    sum[k % dimension] += partials[k];
+  }
+}
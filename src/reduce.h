@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+
+// Component-wise reductions over count vectors of dimension (1 to 4) floats
+// each, stored one after another. AVX2 when the CPU has it, split across
+// threads for large inputs, so they run at about memory bandwidth.
+
+// min and max receive dimension values. With count 0 they are FLT_MAX and
+// -FLT_MAX, like emptyAABB().
+void reduceMinMax(const float data[], size_t count, int dimension,
+                  float min[], float max[]);
+
+// Sums accumulate in double, so means over millions of values keep full
+// float precision.
+void reduceSum(const float data[], size_t count, int dimension,
+               double sum[]);
+
+inline AABB getBounds(const glm::vec2 points[], size_t count) {
+  AABB box;
+  reduceMinMax((const float *)points, count, 2, &box.min.x, &box.max.x);
+  return box;
+}
+
+inline void getBounds(const glm::vec3 points[], size_t count, glm::vec3 &min,
+                      glm::vec3 &max) {
+  reduceMinMax((const float *)points, count, 3, &min.x, &max.x);
+}
+
+inline float getMin(const float values[], size_t count) {
+  float min, max;
+  reduceMinMax(values, count, 1, &min, &max);
+  return min;
+}
+
+inline float getMax(const float values[], size_t count) {
+  float min, max;
+  reduceMinMax(values, count, 1, &min, &max);
+  return max;
+}
+
+inline double getSum(const float values[], size_t count) {
+  double sum;
+  reduceSum(values, count, 1, &sum);
+  return sum;
+}
+
+template <int D>
+glm::vec<D, double> getSum(const glm::vec<D, float> values[], size_t count) {
+  glm::vec<D, double> sum;
+  reduceSum((const float *)values, count, D, &sum.x);
+  return sum;
+}
+
+// Means of empty arrays are NaN.
+inline float getMean(const float values[], size_t count) {
+  return (float)(getSum(values, count) / (double)count);
+}
+
+template <int D>
+glm::vec<D, float> getMean(const glm::vec<D, float> values[], size_t count) {
+  return glm::vec<D, float>(getSum(values, count) / (double)count);
+}
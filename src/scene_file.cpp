@@ -0,0 +1,209 @@
+#include "scene_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint64_t alignSceneOffset(uint64_t offset) {
+  return (offset + SCENE_FILE_ALIGNMENT - 1) & ~(SCENE_FILE_ALIGNMENT - 1);
+}
+
+void writeSection(std::ofstream &out, uint64_t offset, const void *data,
+                  uint64_t size) {
+  static const char padding[SCENE_FILE_ALIGNMENT] = {};
+  uint64_t position = out.tellp();
+  out.write(padding, offset - position);
+  out.write((const char *)data, size);
+}
+
+bool writeSceneFile(const char *path, uint32_t nodeCount,
+                    const std::vector<DrawElementsIndirectCommand> &commands,
+                    const std::vector<AABB> &bounds,
+                    const std::vector<Vertex> &vertices,
+                    const std::vector<GLuint> &indices) {
+  if (commands.size() != bounds.size()) {
+    std::cerr << "Scene file " << path << ": every shape needs bounds"
+              << std::endl;
+    return false;
+  }
+
+  std::vector<SceneShape> shapes(commands.size());
+  for (size_t i = 0; i < commands.size(); ++i) {
+    const DrawElementsIndirectCommand &command = commands[i];
+    shapes[i].bounds = bounds[i];
+    shapes[i].maxIndex = 0;
+    for (GLuint j = 0; j < command.count; ++j) {
+      shapes[i].maxIndex =
+          std::max(shapes[i].maxIndex, indices[command.firstIndex + j]);
+    }
+  }
+
+  SceneFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+  header.version = SCENE_FILE_VERSION;
+  header.nodeCount = nodeCount;
+  header.shapeCount = commands.size();
+  header.vertexCount = vertices.size();
+  header.indexCount = indices.size();
+  header.commandOffset = alignSceneOffset(sizeof(header));
+  header.shapeOffset = alignSceneOffset(
+      header.commandOffset +
+      commands.size() * sizeof(DrawElementsIndirectCommand));
+  header.vertexOffset =
+      alignSceneOffset(header.shapeOffset + shapes.size() * sizeof(SceneShape));
+  header.indexOffset =
+      alignSceneOffset(header.vertexOffset + vertices.size() * sizeof(Vertex));
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+  out.write((const char *)&header, sizeof(header));
+  writeSection(out, header.commandOffset, commands.data(),
+               commands.size() * sizeof(DrawElementsIndirectCommand));
+  writeSection(out, header.shapeOffset, shapes.data(),
+               shapes.size() * sizeof(SceneShape));
+  writeSection(out, header.vertexOffset, vertices.data(),
+               vertices.size() * sizeof(Vertex));
+  writeSection(out, header.indexOffset, indices.data(),
+               indices.size() * sizeof(GLuint));
+
+  if (!out) {
+    std::cerr << "Failed to write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+MappedSceneFile::~MappedSceneFile() { close(); }
+
+bool MappedSceneFile::open(const char *path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(SceneFileHeader)) {
+    std::cerr << "Scene file " << path << " is truncated" << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Cannot map " << path << std::endl;
+    return false;
+  }
+  // The blobs are read front to back exactly once during upload.
+  madvise(mapping, info.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+  data = (const unsigned char *)mapping;
+  size = info.st_size;
+  if (!validate(path)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedSceneFile::close() {
+  if (data) {
+    munmap((void *)data, size);
+    data = nullptr;
+    size = 0;
+  }
+}
+
+bool MappedSceneFile::validate(const char *path) const {
+  const SceneFileHeader &header = getHeader();
+  if (memcmp(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic)) != 0) {
+    std::cerr << path << " is not a scene file" << std::endl;
+    return false;
+  }
+  if (header.version != SCENE_FILE_VERSION) {
+    std::cerr << "Scene file " << path << " has unsupported version "
+              << header.version << std::endl;
+    return false;
+  }
+
+  if (header.nodeCount > SCENE_FILE_MAX_NODES) {
+    std::cerr << "Scene file " << path << " has too many nodes" << std::endl;
+    return false;
+  }
+
+  // Counts are checked by division so a huge count cannot wrap the byte size
+  // around to something that fits.
+  struct Section {
+    uint64_t offset;
+    uint64_t count;
+    uint64_t stride;
+  };
+  const Section sections[] = {
+      {header.commandOffset, header.shapeCount,
+       sizeof(DrawElementsIndirectCommand)},
+      {header.shapeOffset, header.shapeCount, sizeof(SceneShape)},
+      {header.vertexOffset, header.vertexCount, sizeof(Vertex)},
+      {header.indexOffset, header.indexCount, sizeof(GLuint)},
+  };
+  for (const Section &section : sections) {
+    if (section.offset % SCENE_FILE_ALIGNMENT != 0 || section.offset > size ||
+        section.count > (size - section.offset) / section.stride) {
+      std::cerr << "Scene file " << path << " has an invalid section"
+                << std::endl;
+      return false;
+    }
+  }
+
+  // baseVertex is added to every index, so the largest index of each shape
+  // must stay inside the vertex section too.
+  const DrawElementsIndirectCommand *commands = getCommands();
+  const SceneShape *shapes = getShapes();
+  for (uint32_t i = 0; i < header.shapeCount; ++i) {
+    const DrawElementsIndirectCommand &command = commands[i];
+    bool valid = (uint64_t)command.firstIndex + command.count <=
+                     header.indexCount &&
+                 command.baseInstance < header.nodeCount &&
+                 command.baseVertex >= 0;
+    if (!valid || (command.count > 0 &&
+                   (uint64_t)command.baseVertex + shapes[i].maxIndex >=
+                       header.vertexCount)) {
+      std::cerr << "Scene file " << path << " has an invalid shape " << i
+                << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+const SceneFileHeader &MappedSceneFile::getHeader() const {
+  return *(const SceneFileHeader *)data;
+}
+
+const DrawElementsIndirectCommand *MappedSceneFile::getCommands() const {
+  return (const DrawElementsIndirectCommand *)(data +
+                                               getHeader().commandOffset);
+}
+
+const SceneShape *MappedSceneFile::getShapes() const {
+  return (const SceneShape *)(data + getHeader().shapeOffset);
+}
+
+const Vertex *MappedSceneFile::getVertices() const {
+  return (const Vertex *)(data + getHeader().vertexOffset);
+}
+
+const GLuint *MappedSceneFile::getIndices() const {
+  return (const GLuint *)(data + getHeader().indexOffset);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bvh.h"
+#include "shape_batch.h"
+
+// Binary scene layout, version 3. Every section starts on a 64-byte boundary
+// so it can be handed to the GPU straight from a memory mapping:
+//
+//   SceneFileHeader
+//   DrawElementsIndirectCommand[shapeCount]   (baseInstance = scene node)
+//   SceneShape[shapeCount]                    (bounds and largest index)
+//   Vertex[vertexCount]                       (interleaved position/color)
+//   GLuint[indexCount]                        (triangle list indices)
+const char SCENE_FILE_MAGIC[4] = {'N', 'S', 'C', 'N'};
+// Version 2: task2's scene nodes gained SHAPE_IMPORT, which shifts the
+// baseInstance of stress shapes.
+// Version 3: the bounds table became a shape table with each shape's largest
+// index.
+const uint32_t SCENE_FILE_VERSION = 3;
+const uint64_t SCENE_FILE_ALIGNMENT = 64;
+// Every node becomes a ShapeData entry on the GPU, so the node count is capped
+// well below anything a real scene needs.
+const uint32_t SCENE_FILE_MAX_NODES = 1 << 24;
+
+struct SceneFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t nodeCount;
+  uint32_t shapeCount;
+  uint64_t vertexCount;
+  uint64_t indexCount;
+  uint64_t commandOffset;
+  uint64_t shapeOffset;
+  uint64_t vertexOffset;
+  uint64_t indexOffset;
+};
+
+static_assert(sizeof(SceneFileHeader) == SCENE_FILE_ALIGNMENT,
+              "scene file header must fill one aligned block");
+
+// The loader checks maxIndex against the vertex section instead of reading
+// the indices, so the writer is trusted to store the real maximum.
+struct SceneShape {
+  AABB bounds;     // node-local
+  GLuint maxIndex; // largest index of the shape, before baseVertex
+};
+
+bool writeSceneFile(const char *path, uint32_t nodeCount,
+                    const std::vector<DrawElementsIndirectCommand> &commands,
+                    const std::vector<AABB> &bounds,
+                    const std::vector<Vertex> &vertices,
+                    const std::vector<GLuint> &indices);
+
+// Read-only memory mapping of a scene file. The accessors point into the
+// mapping and stay valid until close().
+class MappedSceneFile {
+public:
+  ~MappedSceneFile();
+
+  bool open(const char *path);
+  void close();
+
+  const SceneFileHeader &getHeader() const;
+  const DrawElementsIndirectCommand *getCommands() const;
+  const SceneShape *getShapes() const;
+  const Vertex *getVertices() const;
+  const GLuint *getIndices() const;
+
+private:
+  bool validate(const char *path) const;
+
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+};
@@ -0,0 +1,54 @@
+#include "scene_graph.h"
+
+#include <climits>
+
+int SceneGraph::addNode(int parent, const Affine2 &local) {
+  int node = parents.size();
+  parents.push_back(parent);
+  locals.push_back(local);
+  worlds.push_back(local);
+  dirty.push_back(1);
+  if (node < firstDirty) {
+    firstDirty = node;
+  }
+  return node;
+}
+
+void SceneGraph::setLocal(int node, const Affine2 &local) {
+  locals[node] = local;
+  dirty[node] = 1;
+  if (node < firstDirty) {
+    firstDirty = node;
+  }
+}
+
+bool SceneGraph::update(int &firstChanged, int &lastChanged) {
+  firstChanged = INT_MAX;
+  lastChanged = -1;
+
+  // Parents precede children, so a node's dirty flag is final by the time
+  // its children are visited and nodes before firstDirty cannot change.
+  int count = parents.size();
+  for (int i = firstDirty; i < count; ++i) {
+    int parent = parents[i];
+    if (parent >= 0 && dirty[parent]) {
+      dirty[i] = 1;
+    }
+    if (!dirty[i]) {
+      continue;
+    }
+
+    worlds[i] =
+        (parent >= 0) ? composeAffine(worlds[parent], locals[i]) : locals[i];
+    if (i < firstChanged) {
+      firstChanged = i;
+    }
+    lastChanged = i;
+  }
+
+  for (int i = firstChanged; i <= lastChanged; ++i) {
+    dirty[i] = 0;
+  }
+  firstDirty = count;
+  return lastChanged >= 0;
+}
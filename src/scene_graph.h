@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "affine.h"
+
+// 2D transform hierarchy stored as flat arrays in parent-before-child order.
+// Local transforms are 2x3 affines; world transforms are recomputed by
+// update() in one linear pass that only touches dirty subtrees.
+class SceneGraph {
+public:
+  // parent must be -1 or an existing node, which keeps the order valid.
+  int addNode(int parent, const Affine2 &local = identityAffine2());
+
+  void setLocal(int node, const Affine2 &local);
+  const Affine2 &getLocal(int node) const { return locals[node]; }
+  const Affine2 &getWorld(int node) const { return worlds[node]; }
+  int getParent(int node) const { return parents[node]; }
+  int size() const { return parents.size(); }
+
+  // Recomputes world transforms below every dirty node. Returns false if
+  // nothing changed; otherwise [firstChanged, lastChanged] covers every
+  // updated node.
+  bool update(int &firstChanged, int &lastChanged);
+
+private:
+  std::vector<int> parents;
+  std::vector<Affine2> locals;
+  std::vector<Affine2> worlds;
+  std::vector<unsigned char> dirty;
+  int firstDirty = 0;
+};
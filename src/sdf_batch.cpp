@@ -0,0 +1,47 @@
+#include "sdf_batch.h"
+
+void SdfBatch::add(const PolygonParams &ellipse) { ellipses.push_back(ellipse); }
+
+void SdfBatch::upload(GLuint program) {
+  glGenVertexArrays(1, &vao);
+
+  glGenBuffers(1, &ellipseBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, ellipseBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER,
+               ellipses.size() * sizeof(PolygonParams), ellipses.data(),
+               GL_DYNAMIC_DRAW);
+  drawCount = ellipses.size();
+
+  pixelSizeLocation = glGetUniformLocation(program, "pixelSize");
+}
+
+void SdfBatch::setVisible(const std::vector<int> &visible) {
+  visibleEllipses.clear();
+  for (int index : visible) {
+    visibleEllipses.push_back(ellipses[index]);
+  }
+  drawCount = visibleEllipses.size();
+
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, ellipseBuffer);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                  drawCount * sizeof(PolygonParams), visibleEllipses.data());
+}
+
+void SdfBatch::draw(glm::vec2 pixelSize) const {
+  if (drawCount == 0) {
+    return;
+  }
+
+  // Used to pad each quad for the anti-aliased fringe.
+  glUniform2f(pixelSizeLocation, pixelSize.x, pixelSize.y);
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glBindVertexArray(vao);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POLYGON_BUFFER_BINDING,
+                   ellipseBuffer);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, drawCount);
+
+  glDisable(GL_BLEND);
+}
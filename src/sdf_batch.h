@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "procedural_batch.h"
+
+// Draws ellipses as one instanced quad each. The fragment shader evaluates
+// the ellipse analytically and anti-aliases the edge in screen space, so the
+// cost no longer depends on a tessellation segment count.
+class SdfBatch {
+public:
+  void add(const PolygonParams &ellipse);
+
+  void upload(GLuint program);
+  // Packs the listed ellipses to the front of the buffer and draws only those.
+  void setVisible(const std::vector<int> &visible);
+  // pixelSize is the world-space size of one framebuffer pixel.
+  void draw(glm::vec2 pixelSize) const;
+
+  int ellipseCount() const { return ellipses.size(); }
+  int visibleCount() const { return drawCount; }
+
+private:
+  std::vector<PolygonParams> ellipses;
+  std::vector<PolygonParams> visibleEllipses;
+  int drawCount = 0;
+
+  GLuint vao = 0;
+  GLuint ellipseBuffer = 0;
+  GLint pixelSizeLocation = -1;
+};
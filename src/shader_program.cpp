@@ -0,0 +1,65 @@
+#include "shader_program.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool readShaderFile(const char *filename, std::string &source) {
+  std::ifstream in(filename);
+  if (!in) {
+    std::cerr << "Cannot open " << filename << std::endl;
+    return false;
+  }
+  std::stringstream ss;
+  ss << in.rdbuf();
+  source = ss.str();
+  return true;
+}
+
+GLuint compileShader(GLenum type, const std::string &source,
+                     const char *stage) {
+  const char *shaderSrc = source.c_str();
+
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &shaderSrc, NULL);
+  glCompileShader(shader);
+
+  GLint compiled;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+  if (!compiled) {
+    char log[1024];
+    glGetShaderInfoLog(shader, 1024, NULL, log);
+    std::cerr << stage << " shader compile error:\n" << log << std::endl;
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+GLuint compileProgram(const std::string &vsrc, const std::string &fsrc) {
+  GLuint vShader = compileShader(GL_VERTEX_SHADER, vsrc, "Vertex");
+  GLuint fShader = compileShader(GL_FRAGMENT_SHADER, fsrc, "Fragment");
+  if (vShader == 0 || fShader == 0) {
+    glDeleteShader(vShader);
+    glDeleteShader(fShader);
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vShader);
+  glAttachShader(program, fShader);
+  glLinkProgram(program);
+  glDeleteShader(vShader);
+  glDeleteShader(fShader);
+
+  GLint linked;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    char log[1024];
+    glGetProgramInfoLog(program, 1024, NULL, log);
+    std::cerr << "Shader program link error:\n" << log << std::endl;
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
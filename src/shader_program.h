@@ -0,0 +1,11 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+
+// Reads a whole shader file. Returns false if it cannot be opened.
+bool readShaderFile(const char *filename, std::string &source);
+
+// Compiles and links a vertex/fragment program in the current context. Errors
+// are logged; returns 0 if either stage or the link failed.
+GLuint compileProgram(const std::string &vsrc, const std::string &fsrc);
@@ -0,0 +1,167 @@
+#include "shader_reloader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "shader_program.h"
+
+// Editors often save in several writes or through a rename; events arriving
+// within this window are handled as one change.
+const int RELOAD_SETTLE_MS = 50;
+
+bool ShaderReloader::start(GLFWwindow *window, const char *directory) {
+  this->directory = directory;
+
+  inotifyFd = inotify_init1(IN_CLOEXEC);
+  if (inotifyFd < 0 ||
+      inotify_add_watch(inotifyFd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) <
+          0) {
+    std::cerr << "Cannot watch " << directory << " for shader changes"
+              << std::endl;
+    stop();
+    return false;
+  }
+  stopFd = eventfd(0, EFD_CLOEXEC);
+
+  // Uses the window's context hints, so the versions match.
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  context = glfwCreateWindow(1, 1, "shader reload", NULL, window);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+  if (context == NULL) {
+    std::cerr << "Cannot create a shared context for shader reloading"
+              << std::endl;
+    stop();
+    return false;
+  }
+
+  thread = std::thread(&ShaderReloader::run, this);
+  return true;
+}
+
+void ShaderReloader::stop() {
+  if (thread.joinable()) {
+    uint64_t one = 1;
+    if (write(stopFd, &one, sizeof(one)) < 0) {
+      std::cerr << "Cannot stop the shader reload thread" << std::endl;
+    }
+    thread.join();
+  }
+  if (context) {
+    glfwDestroyWindow(context);
+    context = NULL;
+  }
+  if (inotifyFd >= 0) {
+    close(inotifyFd);
+    inotifyFd = -1;
+  }
+  if (stopFd >= 0) {
+    close(stopFd);
+    stopFd = -1;
+  }
+}
+
+void ShaderReloader::watch(GLuint *program, const char *vShaderFile,
+                           const char *fShaderFile) {
+  std::lock_guard<std::mutex> lock(mutex);
+  programs.emplace_back(new WatchedProgram{program, vShaderFile, fShaderFile});
+}
+
+int ShaderReloader::applyReloads() {
+  if (!reloaded.exchange(false, std::memory_order_acquire)) {
+    return 0;
+  }
+  int count = 0;
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const std::unique_ptr<WatchedProgram> &entry : programs) {
+    GLuint program = entry->pending.exchange(0, std::memory_order_acquire);
+    if (program != 0) {
+      glDeleteProgram(*entry->program);
+      *entry->program = program;
+      count++;
+    }
+  }
+  return count;
+}
+
+void ShaderReloader::run() {
+  glfwMakeContextCurrent(context);
+
+  alignas(inotify_event) char buffer[4096];
+  pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+  std::vector<std::string> changedFiles;
+
+  for (;;) {
+    if (poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN)) {
+      break;
+    }
+
+    // Collect this burst of events, then let the writer settle.
+    changedFiles.clear();
+    int timeout = 0;
+    while (poll(fds, 1, timeout) > 0) {
+      ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+      if (length <= 0) {
+        break;
+      }
+      for (char *p = buffer; p < buffer + length;) {
+        inotify_event *event = (inotify_event *)p;
+        if (event->len > 0) {
+          changedFiles.push_back(directory + "/" + event->name);
+        }
+        p += sizeof(inotify_event) + event->len;
+      }
+      timeout = RELOAD_SETTLE_MS;
+    }
+    rebuild(changedFiles);
+  }
+
+  glfwMakeContextCurrent(NULL);
+}
+
+void ShaderReloader::rebuild(const std::vector<std::string> &changedFiles) {
+  std::vector<WatchedProgram *> watched;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::unique_ptr<WatchedProgram> &entry : programs) {
+      watched.push_back(entry.get());
+    }
+  }
+
+  for (WatchedProgram *entry : watched) {
+    bool changed =
+        std::find(changedFiles.begin(), changedFiles.end(),
+                  entry->vShaderFile) != changedFiles.end() ||
+        std::find(changedFiles.begin(), changedFiles.end(),
+                  entry->fShaderFile) != changedFiles.end();
+    if (!changed) {
+      continue;
+    }
+
+    std::string vsrc, fsrc;
+    GLuint program = 0;
+    if (readShaderFile(entry->vShaderFile.c_str(), vsrc) &&
+        readShaderFile(entry->fShaderFile.c_str(), fsrc)) {
+      program = compileProgram(vsrc, fsrc);
+    }
+    if (program == 0) {
+      std::cerr << "Keeping the previous " << entry->vShaderFile << " + "
+                << entry->fShaderFile << " program" << std::endl;
+      continue;
+    }
+
+    // The render thread may use the program as soon as it is pending. A
+    // program it has not taken yet was never used, so it can go right away.
+    glFinish();
+    GLuint stale = entry->pending.exchange(program, std::memory_order_release);
+    if (stale != 0) {
+      glDeleteProgram(stale);
+    }
+    reloaded.store(true, std::memory_order_release);
+    std::cout << "Reloaded " << entry->vShaderFile << " + "
+              << entry->fShaderFile << std::endl;
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Rebuilds programs when their shader files change. A thread blocks on
+// inotify for the shader directory and compiles changed programs on a hidden
+// context that shares objects with the window's, so the render thread never
+// waits on the compiler. Finished programs are swapped in between frames; a
+// program that fails to compile or link leaves the old one in place. Only the
+// latest rebuild of each program waits to be swapped, so saves that arrive
+// while nobody calls applyReloads() replace each other.
+class ShaderReloader {
+public:
+  ~ShaderReloader() { stop(); }
+
+  // Call on the main thread after the window's context is current.
+  bool start(GLFWwindow *window, const char *directory);
+  void stop();
+
+  // *program is replaced whenever either file changes.
+  void watch(GLuint *program, const char *vShaderFile,
+             const char *fShaderFile);
+  // Swaps in the programs rebuilt since the last call and deletes the old
+  // ones. Call on the render thread between frames; returns the number
+  // swapped.
+  int applyReloads();
+
+private:
+  struct WatchedProgram {
+    GLuint *program;
+    std::string vShaderFile;
+    std::string fShaderFile;
+    // Rebuilt program waiting to replace *program, or 0.
+    std::atomic<GLuint> pending{0};
+  };
+
+  void run();
+  void rebuild(const std::vector<std::string> &changedFiles);
+
+  std::string directory;
+  GLFWwindow *context = NULL;
+  int inotifyFd = -1;
+  int stopFd = -1;
+  std::thread thread;
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<WatchedProgram>> programs;
+  // Set after a program is made pending, so frames without reloads skip the
+  // lock.
+  std::atomic<bool> reloaded{false};
+};
@@ -0,0 +1,233 @@
+#include "shape_batch.h"
+
+#include <algorithm>
+
+#ifndef BUFFER_OFFSET
+#define BUFFER_OFFSET(offset) ((GLvoid *)(offset))
+#endif
+
+void GeometryChunk::addCommand(int numIndices, GLuint shapeIndex) {
+  DrawElementsIndirectCommand command;
+  command.count = numIndices;
+  command.instanceCount = 1;
+  command.firstIndex = indices.size();
+  command.baseVertex = vertices.size();
+  command.baseInstance = shapeIndex;
+  commands.push_back(command);
+}
+
+void GeometryChunk::addTriangles(const glm::vec2 vertices[],
+                                 const glm::vec3 colors[], int numPoints,
+                                 GLuint shapeIndex) {
+  addCommand(numPoints, shapeIndex);
+
+  for (int i = 0; i < numPoints; ++i) {
+    indices.push_back(i);
+    this->vertices.push_back({vertices[i], colors[i]});
+  }
+}
+
+void GeometryChunk::addTriangleFan(const glm::vec2 vertices[],
+                                   const glm::vec3 colors[], int numPoints,
+                                   GLuint shapeIndex) {
+  if (numPoints < 3) {
+    return;
+  }
+
+  // A multi-draw call shares one primitive mode, so fans are indexed as
+  // triangle lists around their first vertex.
+  addCommand(3 * (numPoints - 2), shapeIndex);
+
+  for (int i = 1; i < numPoints - 1; ++i) {
+    indices.push_back(0);
+    indices.push_back(i);
+    indices.push_back(i + 1);
+  }
+  for (int i = 0; i < numPoints; ++i) {
+    this->vertices.push_back({vertices[i], colors[i]});
+  }
+}
+
+void GeometryChunk::addIndexedTriangles(const glm::vec2 vertices[],
+                                        const glm::vec3 colors[],
+                                        int numPoints, const GLuint indices[],
+                                        int numIndices, GLuint shapeIndex) {
+  if (numIndices < 3) {
+    return;
+  }
+
+  addCommand(numIndices, shapeIndex);
+
+  this->indices.insert(this->indices.end(), indices, indices + numIndices);
+  for (int i = 0; i < numPoints; ++i) {
+    this->vertices.push_back({vertices[i], colors[i]});
+  }
+}
+
+// Returns a buffer of newCapacity bytes holding the first usedBytes of buffer,
+// which is deleted.
+GLuint growBuffer(GLuint buffer, size_t usedBytes, size_t newCapacity) {
+  GLuint grown;
+  glGenBuffers(1, &grown);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+  glBufferStorage(GL_COPY_WRITE_BUFFER, newCapacity, NULL,
+                  GL_DYNAMIC_STORAGE_BIT);
+  if (buffer != 0 && usedBytes > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        usedBytes);
+  }
+  glDeleteBuffers(1, &buffer);
+  return grown;
+}
+
+size_t getGrownCapacity(size_t capacity, size_t required) {
+  return std::max(required, std::max<size_t>(2 * capacity, 1024));
+}
+
+void ShapeBatch::upload(GLuint program) {
+  commands = staging.commands;
+  createBuffers(program, staging.vertices.data(), staging.vertices.size(),
+                staging.indices.data(), staging.indices.size());
+}
+
+void ShapeBatch::uploadExternal(GLuint program, const Vertex *vertices,
+                                size_t vertexCount, const GLuint *indices,
+                                size_t indexCount,
+                                const DrawElementsIndirectCommand *commands,
+                                size_t commandCount) {
+  this->commands.assign(commands, commands + commandCount);
+  createBuffers(program, vertices, vertexCount, indices, indexCount);
+}
+
+void ShapeBatch::createBuffers(GLuint program, const Vertex *vertices,
+                               size_t vertexCount, const GLuint *indices,
+                               size_t indexCount) {
+  positionLocation = glGetAttribLocation(program, "vPosition");
+  colorLocation = glGetAttribLocation(program, "vColor");
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+
+  this->vertexCount = vertexCount;
+  this->indexCount = indexCount;
+  vertexCapacity = std::max<size_t>(vertexCount, 1);
+  indexCapacity = std::max<size_t>(indexCount, 1);
+  commandCapacity = std::max<size_t>(commands.size(), 1);
+
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferStorage(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), NULL,
+                  GL_DYNAMIC_STORAGE_BIT);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, vertexCount * sizeof(Vertex), vertices);
+
+  glGenBuffers(1, &ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(GLuint),
+                  NULL, GL_DYNAMIC_STORAGE_BIT);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount * sizeof(GLuint),
+                  indices);
+
+  glGenBuffers(1, &indirectBuffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+  glBufferStorage(GL_DRAW_INDIRECT_BUFFER,
+                  commandCapacity * sizeof(DrawElementsIndirectCommand), NULL,
+                  GL_DYNAMIC_STORAGE_BIT);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+                  commands.size() * sizeof(DrawElementsIndirectCommand),
+                  commands.data());
+  drawCount = commands.size();
+
+  bindVertexBuffers();
+}
+
+void ShapeBatch::bindVertexBuffers() {
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glEnableVertexAttribArray(positionLocation);
+  glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(Vertex),
+                        BUFFER_OFFSET(offsetof(Vertex, position)));
+  glEnableVertexAttribArray(colorLocation);
+  glVertexAttribPointer(colorLocation, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        BUFFER_OFFSET(offsetof(Vertex, color)));
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+}
+
+void ShapeBatch::appendChunk(const GeometryChunk &chunk) {
+  size_t newVertexCount = vertexCount + chunk.vertices.size();
+  size_t newIndexCount = indexCount + chunk.indices.size();
+  size_t newCommandCount = commands.size() + chunk.commands.size();
+
+  if (newVertexCount > vertexCapacity || newIndexCount > indexCapacity) {
+    if (newVertexCount > vertexCapacity) {
+      vertexCapacity = getGrownCapacity(vertexCapacity, newVertexCount);
+      vbo = growBuffer(vbo, vertexCount * sizeof(Vertex),
+                       vertexCapacity * sizeof(Vertex));
+    }
+    if (newIndexCount > indexCapacity) {
+      indexCapacity = getGrownCapacity(indexCapacity, newIndexCount);
+      ebo = growBuffer(ebo, indexCount * sizeof(GLuint),
+                       indexCapacity * sizeof(GLuint));
+    }
+    bindVertexBuffers();
+  }
+  if (newCommandCount > commandCapacity) {
+    commandCapacity = getGrownCapacity(commandCapacity, newCommandCount);
+    indirectBuffer = growBuffer(
+        indirectBuffer, commands.size() * sizeof(DrawElementsIndirectCommand),
+        commandCapacity * sizeof(DrawElementsIndirectCommand));
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferSubData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex),
+                  chunk.vertices.size() * sizeof(Vertex),
+                  chunk.vertices.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, indexCount * sizeof(GLuint),
+                  chunk.indices.size() * sizeof(GLuint), chunk.indices.data());
+
+  // Chunk commands are relative to the chunk; rebase them onto the batch.
+  size_t firstCommand = commands.size();
+  for (DrawElementsIndirectCommand command : chunk.commands) {
+    command.firstIndex += indexCount;
+    command.baseVertex += vertexCount;
+    commands.push_back(command);
+  }
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+                  firstCommand * sizeof(DrawElementsIndirectCommand),
+                  chunk.commands.size() * sizeof(DrawElementsIndirectCommand),
+                  &commands[firstCommand]);
+
+  vertexCount = newVertexCount;
+  indexCount = newIndexCount;
+  drawCount = commands.size();
+}
+
+void ShapeBatch::setVisible(const std::vector<int> &visible) {
+  if (indirectBuffer == 0) {
+    return;
+  }
+
+  visibleCommands.clear();
+  for (int index : visible) {
+    visibleCommands.push_back(commands[index]);
+  }
+  drawCount = visibleCommands.size();
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+                  drawCount * sizeof(DrawElementsIndirectCommand),
+                  visibleCommands.data());
+}
+
+void ShapeBatch::draw() const {
+  if (drawCount == 0) {
+    return;
+  }
+
+  glBindVertexArray(vao);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+  glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, BUFFER_OFFSET(0),
+                              drawCount, 0);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+// Matches the layout glMultiDrawArraysIndirect reads from
+// GL_DRAW_INDIRECT_BUFFER.
+struct DrawArraysIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint first;
+  GLuint baseInstance;
+};
+
+// Matches the layout glMultiDrawElementsIndirect reads from
+// GL_DRAW_INDIRECT_BUFFER.
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+// Interleaved vertex layout shared by ShapeBatch and the binary scene format.
+struct Vertex {
+  glm::vec2 position;
+  glm::vec3 color;
+};
+
+// CPU-side geometry in batch layout. It has no GL state, so worker threads
+// can fill chunks that the render thread later appends to a ShapeBatch.
+struct GeometryChunk {
+  void addTriangles(const glm::vec2 vertices[], const glm::vec3 colors[],
+                    int numPoints, GLuint shapeIndex);
+  void addTriangleFan(const glm::vec2 vertices[], const glm::vec3 colors[],
+                      int numPoints, GLuint shapeIndex);
+  void addIndexedTriangles(const glm::vec2 vertices[],
+                           const glm::vec3 colors[], int numPoints,
+                           const GLuint indices[], int numIndices,
+                           GLuint shapeIndex);
+
+  std::vector<Vertex> vertices;
+  std::vector<GLuint> indices;
+  std::vector<DrawElementsIndirectCommand> commands;
+
+private:
+  void addCommand(int numIndices, GLuint shapeIndex);
+};
+
+// Collects the geometry of many shapes into one vertex buffer, one index
+// buffer and one indirect command buffer so a whole scene is submitted with a
+// single glMultiDrawElementsIndirect call. Every command is drawn as
+// GL_TRIANGLES with indices relative to its baseVertex, and carries its shape
+// index as the base instance.
+class ShapeBatch {
+public:
+  void addTriangles(const glm::vec2 vertices[], const glm::vec3 colors[],
+                    int numPoints, GLuint shapeIndex) {
+    staging.addTriangles(vertices, colors, numPoints, shapeIndex);
+  }
+  void addTriangleFan(const glm::vec2 vertices[], const glm::vec3 colors[],
+                      int numPoints, GLuint shapeIndex) {
+    staging.addTriangleFan(vertices, colors, numPoints, shapeIndex);
+  }
+  // Indices are relative to vertices, e.g. the output of
+  // triangulatePolygon().
+  void addIndexedTriangles(const glm::vec2 vertices[],
+                           const glm::vec3 colors[], int numPoints,
+                           const GLuint indices[], int numIndices,
+                           GLuint shapeIndex) {
+    staging.addIndexedTriangles(vertices, colors, numPoints, indices,
+                                numIndices, shapeIndex);
+  }
+
+  void upload(GLuint program);
+  // Uploads geometry straight from caller-owned memory, such as a mapped
+  // scene file. Only the command table is copied.
+  void uploadExternal(GLuint program, const Vertex *vertices,
+                      size_t vertexCount, const GLuint *indices,
+                      size_t indexCount,
+                      const DrawElementsIndirectCommand *commands,
+                      size_t commandCount);
+  // Adds geometry after upload(). Buffers grow by copying into a larger
+  // buffer on the GPU. The indirect buffer must hold the full command list,
+  // so call setVisible() only once appending is finished.
+  void appendChunk(const GeometryChunk &chunk);
+  // Restricts drawing to the listed commands, e.g. the result of culling.
+  void setVisible(const std::vector<int> &visible);
+  void draw() const;
+
+  int commandCount() const { return commands.size(); }
+  int visibleCount() const { return drawCount; }
+
+  const std::vector<Vertex> &getVertices() const { return staging.vertices; }
+  const std::vector<GLuint> &getIndices() const { return staging.indices; }
+  const std::vector<DrawElementsIndirectCommand> &getCommands() const {
+    return commands;
+  }
+
+private:
+  void createBuffers(GLuint program, const Vertex *vertices,
+                     size_t vertexCount, const GLuint *indices,
+                     size_t indexCount);
+  void bindVertexBuffers();
+
+  GeometryChunk staging;
+  std::vector<DrawElementsIndirectCommand> commands;
+  std::vector<DrawElementsIndirectCommand> visibleCommands;
+  int drawCount = 0;
+
+  size_t vertexCount = 0;
+  size_t indexCount = 0;
+  size_t vertexCapacity = 0;
+  size_t indexCapacity = 0;
+  size_t commandCapacity = 0;
+
+  GLuint vao = 0;
+  GLuint vbo = 0;
+  GLuint ebo = 0;
+  GLuint indirectBuffer = 0;
+  GLint positionLocation = -1;
+  GLint colorLocation = -1;
+};
@@ -0,0 +1,40 @@
+#include "shape_culler.h"
+
+#include <algorithm>
+
+// Above this many commands the Morton-ordered linear build is used; its
+// looser nodes cost less than the median split's build time.
+const size_t LINEAR_BUILD_MIN_COMMANDS = 1 << 16;
+
+void ShapeCuller::add(const AABB &bounds, int node) {
+  localBounds.push_back(bounds);
+  nodes.push_back(node);
+}
+
+void ShapeCuller::build(const SceneGraph &graph) {
+  worldBounds.resize(localBounds.size());
+  for (int i = 0; i < (int)localBounds.size(); ++i) {
+    worldBounds[i] = transformAABB(graph.getWorld(nodes[i]), localBounds[i]);
+  }
+  if (worldBounds.size() >= LINEAR_BUILD_MIN_COMMANDS) {
+    bvh.buildLinear(worldBounds);
+  } else {
+    bvh.build(worldBounds);
+  }
+}
+
+void ShapeCuller::refit(const SceneGraph &graph, int firstNode,
+                        int lastNode) {
+  for (int i = 0; i < (int)localBounds.size(); ++i) {
+    if (nodes[i] >= firstNode && nodes[i] <= lastNode) {
+      worldBounds[i] = transformAABB(graph.getWorld(nodes[i]), localBounds[i]);
+    }
+  }
+  bvh.refit(worldBounds);
+}
+
+void ShapeCuller::query(const AABB &view, std::vector<int> &visible) const {
+  visible.clear();
+  bvh.query(worldBounds, view, visible);
+  std::sort(visible.begin(), visible.end());
+}
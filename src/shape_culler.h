@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "bvh.h"
+#include "scene_graph.h"
+
+// Viewport culling for the draw commands of one batch. Command i has a bounding
+// box in its scene node's local space. World boxes follow node transforms
+// and are indexed by a BVH that is refit when nodes move.
+class ShapeCuller {
+public:
+  void add(const AABB &bounds, int node);
+
+  void build(const SceneGraph &graph);
+  void refit(const SceneGraph &graph, int firstNode, int lastNode);
+
+  // Fills visible with the commands overlapping view in ascending order, so
+  // the batch keeps its original draw order.
+  void query(const AABB &view, std::vector<int> &visible) const;
+
+  int size() const { return nodes.size(); }
+  const std::vector<AABB> &getLocalBounds() const { return localBounds; }
+
+private:
+  std::vector<AABB> localBounds;
+  std::vector<int> nodes;
+  std::vector<AABB> worldBounds;
+  Bvh bvh;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+// Kernels are compiled for several instruction sets with target attributes
+// and picked at run time, so the build needs no -march flags. The SSE2
+// paths are not dispatched, so SIMD_X86 is limited to x86-64, where SSE2
+// is always present.
+#if defined(__x86_64__)
+#define SIMD_X86 1
+#include <immintrin.h>
+
+// Target of the AVX2 kernels; callers check cpuHasAvx2() first.
+#define SIMD_AVX2 __attribute__((target("avx2,fma")))
+
+// Helpers for eight 3D vectors held as x, y and z registers, v[0..2].
+
+SIMD_AVX2 inline __m256 dotLanes(const __m256 a[3], const __m256 b[3]) {
+  return _mm256_fmadd_ps(
+      a[2], b[2], _mm256_fmadd_ps(a[1], b[1], _mm256_mul_ps(a[0], b[0])));
+}
+
+SIMD_AVX2 inline void crossLanes(const __m256 a[3], const __m256 b[3],
+                                 __m256 out[3]) {
+  __m256 x = _mm256_fmsub_ps(a[1], b[2], _mm256_mul_ps(a[2], b[1]));
+  __m256 y = _mm256_fmsub_ps(a[2], b[0], _mm256_mul_ps(a[0], b[2]));
+  out[2] = _mm256_fmsub_ps(a[0], b[1], _mm256_mul_ps(a[1], b[0]));
+  out[0] = x;
+  out[1] = y;
+}
+
+// Reads eight packed vec3s (24 floats) into x, y and z lanes. Vectors 0-3
+// go to the low halves and 4-7 to the high halves, so the 4-wide transpose
+// runs in both halves at once.
+SIMD_AVX2 inline void loadVec3Lanes(const float p[], __m256 v[3]) {
+  __m256 m03 = _mm256_insertf128_ps(
+      _mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+  __m256 m14 = _mm256_insertf128_ps(
+      _mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+  __m256 m25 = _mm256_insertf128_ps(
+      _mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+  __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+  __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+  v[0] = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+  v[1] = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+  v[2] = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+// Inverse of loadVec3Lanes.
+SIMD_AVX2 inline void storeVec3Lanes(float q[], const __m256 v[3]) {
+  __m256 xy = _mm256_shuffle_ps(v[0], v[1], _MM_SHUFFLE(2, 0, 2, 0));
+  __m256 yz = _mm256_shuffle_ps(v[1], v[2], _MM_SHUFFLE(3, 1, 3, 1));
+  __m256 zx = _mm256_shuffle_ps(v[2], v[0], _MM_SHUFFLE(3, 1, 2, 0));
+  __m256 r03 = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+  __m256 r14 = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+  __m256 r25 = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+  _mm_storeu_ps(q, _mm256_castps256_ps128(r03));
+  _mm_storeu_ps(q + 4, _mm256_castps256_ps128(r14));
+  _mm_storeu_ps(q + 8, _mm256_castps256_ps128(r25));
+  _mm_storeu_ps(q + 12, _mm256_extractf128_ps(r03, 1));
+  _mm_storeu_ps(q + 16, _mm256_extractf128_ps(r14, 1));
+  _mm_storeu_ps(q + 20, _mm256_extractf128_ps(r25, 1));
+}
+#endif
+
+inline bool cpuHasBmi2() {
+#ifdef SIMD_X86
+  static const bool supported = __builtin_cpu_supports("bmi2");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+inline bool cpuHasAvx2() {
+#ifdef SIMD_X86
+  static const bool supported =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return supported;
+#else
+  return false;
+#endif
+}
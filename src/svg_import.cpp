@@ -0,0 +1,496 @@
+#include "svg_import.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+struct SvgAttribute {
+  std::string_view name;
+  std::string_view value;
+};
+
+struct NamedColor {
+  const char *name;
+  glm::vec3 color;
+};
+
+const NamedColor SVG_NAMED_COLORS[] = {
+    {"black", glm::vec3(0.0, 0.0, 0.0)},
+    {"white", glm::vec3(1.0, 1.0, 1.0)},
+    {"red", glm::vec3(1.0, 0.0, 0.0)},
+    {"lime", glm::vec3(0.0, 1.0, 0.0)},
+    {"green", glm::vec3(0.0, 128.0 / 255, 0.0)},
+    {"blue", glm::vec3(0.0, 0.0, 1.0)},
+    {"yellow", glm::vec3(1.0, 1.0, 0.0)},
+    {"cyan", glm::vec3(0.0, 1.0, 1.0)},
+    {"magenta", glm::vec3(1.0, 0.0, 1.0)},
+    {"orange", glm::vec3(1.0, 165.0 / 255, 0.0)},
+    {"gray", glm::vec3(128.0 / 255, 128.0 / 255, 128.0 / 255)},
+    {"grey", glm::vec3(128.0 / 255, 128.0 / 255, 128.0 / 255)},
+};
+
+bool isSvgSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+std::string_view trimSvg(std::string_view text) {
+  while (!text.empty() && isSvgSpace(text.front())) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && isSvgSpace(text.back())) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+// Reads the next number from text, skipping separators, and advances text.
+bool nextSvgNumber(std::string_view &text, float &value) {
+  while (!text.empty() && (isSvgSpace(text.front()) || text.front() == ',')) {
+    text.remove_prefix(1);
+  }
+  if (!text.empty() && text.front() == '+') {
+    text.remove_prefix(1);
+  }
+  std::from_chars_result result =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (result.ec != std::errc()) {
+    return false;
+  }
+  text.remove_prefix(result.ptr - text.data());
+  return true;
+}
+
+float parseSvgLength(std::string_view text, float fallback) {
+  float value;
+  return nextSvgNumber(text, value) ? value : fallback;
+}
+
+int parseHexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c |= 0x20;
+  return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+}
+
+// Returns false for "none" or an unrecognised color.
+bool parseSvgColor(std::string_view text, glm::vec3 &color) {
+  text = trimSvg(text);
+  if (text.size() == 7 && text[0] == '#') {
+    for (int i = 0; i < 3; ++i) {
+      int high = parseHexDigit(text[1 + 2 * i]);
+      int low = parseHexDigit(text[2 + 2 * i]);
+      if (high < 0 || low < 0) {
+        return false;
+      }
+      color[i] = (high * 16 + low) / 255.0f;
+    }
+    return true;
+  }
+  if (text.size() == 4 && text[0] == '#') {
+    for (int i = 0; i < 3; ++i) {
+      int digit = parseHexDigit(text[1 + i]);
+      if (digit < 0) {
+        return false;
+      }
+      color[i] = digit * 17 / 255.0f;
+    }
+    return true;
+  }
+  if (text.substr(0, 4) == "rgb(") {
+    text.remove_prefix(4);
+    for (int i = 0; i < 3; ++i) {
+      float channel;
+      if (!nextSvgNumber(text, channel)) {
+        return false;
+      }
+      color[i] = glm::clamp(channel / 255.0f, 0.0f, 1.0f);
+    }
+    return true;
+  }
+  for (const NamedColor &named : SVG_NAMED_COLORS) {
+    if (text == named.name) {
+      color = named.color;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Splits attributes of the element whose name ends at text.begin(), stopping
+// at the closing '>'.
+int parseSvgAttributes(std::string_view text, SvgAttribute attributes[],
+                       int maxAttributes) {
+  int count = 0;
+  size_t i = 0;
+  while (i < text.size() && count < maxAttributes) {
+    while (i < text.size() && isSvgSpace(text[i])) {
+      ++i;
+    }
+    if (i >= text.size() || text[i] == '>' || text[i] == '/') {
+      break;
+    }
+
+    size_t nameStart = i;
+    while (i < text.size() && text[i] != '=' && !isSvgSpace(text[i]) &&
+           text[i] != '>') {
+      ++i;
+    }
+    std::string_view name = text.substr(nameStart, i - nameStart);
+    while (i < text.size() && (isSvgSpace(text[i]) || text[i] == '=')) {
+      ++i;
+    }
+    if (i >= text.size() || (text[i] != '"' && text[i] != '\'')) {
+      break;
+    }
+
+    char quote = text[i++];
+    size_t valueStart = i;
+    while (i < text.size() && text[i] != quote) {
+      ++i;
+    }
+    attributes[count].name = name;
+    attributes[count].value = text.substr(valueStart, i - valueStart);
+    ++count;
+    ++i;
+  }
+  return count;
+}
+
+std::string_view findSvgAttribute(const SvgAttribute attributes[], int count,
+                                  std::string_view name) {
+  for (int i = 0; i < count; ++i) {
+    if (attributes[i].name == name) {
+      return attributes[i].value;
+    }
+  }
+  return std::string_view();
+}
+
+// Applies fill, stroke and stroke-width from attributes and from an inline
+// style, which takes precedence.
+void applySvgPaint(SvgShape &shape, std::string_view name,
+                   std::string_view value) {
+  if (name == "fill") {
+    shape.filled = parseSvgColor(value, shape.fill);
+  } else if (name == "stroke") {
+    if (!parseSvgColor(value, shape.stroke)) {
+      shape.strokeWidth = 0.0;
+    }
+  } else if (name == "stroke-width") {
+    shape.strokeWidth = parseSvgLength(value, shape.strokeWidth);
+  }
+}
+
+void parseSvgPaint(SvgShape &shape, const SvgAttribute attributes[],
+                   int count) {
+  bool hasStroke = false;
+  for (int i = 0; i < count; ++i) {
+    applySvgPaint(shape, attributes[i].name, attributes[i].value);
+    hasStroke |= attributes[i].name == "stroke";
+  }
+
+  std::string_view style = findSvgAttribute(attributes, count, "style");
+  while (!style.empty()) {
+    size_t end = std::min(style.find(';'), style.size());
+    std::string_view declaration = style.substr(0, end);
+    size_t colon = declaration.find(':');
+    if (colon != std::string_view::npos) {
+      std::string_view name = trimSvg(declaration.substr(0, colon));
+      applySvgPaint(shape, name, declaration.substr(colon + 1));
+      hasStroke |= name == "stroke";
+    }
+    style.remove_prefix(std::min(end + 1, style.size()));
+  }
+
+  if (!hasStroke) {
+    shape.strokeWidth = 0.0;
+  }
+}
+
+float getSvgNumber(const SvgAttribute attributes[], int count,
+                   std::string_view name) {
+  return parseSvgLength(findSvgAttribute(attributes, count, name), 0.0);
+}
+
+bool parseSvgElement(std::string_view tag, std::string_view body,
+                     Arena &arena, std::vector<float> &scratch,
+                     SvgShape &shape) {
+  const int MAX_ATTRIBUTES = 32;
+  SvgAttribute attributes[MAX_ATTRIBUTES];
+  int count = parseSvgAttributes(body, attributes, MAX_ATTRIBUTES);
+
+  shape.params = glm::vec4(0.0);
+  shape.points = nullptr;
+  shape.pointCount = 0;
+  shape.filled = true;
+  shape.fill = glm::vec3(0.0);
+  shape.stroke = glm::vec3(0.0);
+  shape.strokeWidth = 1.0;
+
+  if (tag == "rect") {
+    shape.kind = SVG_RECT;
+    shape.params = glm::vec4(getSvgNumber(attributes, count, "x"),
+                             getSvgNumber(attributes, count, "y"),
+                             getSvgNumber(attributes, count, "width"),
+                             getSvgNumber(attributes, count, "height"));
+  } else if (tag == "circle") {
+    shape.kind = SVG_CIRCLE;
+    float r = getSvgNumber(attributes, count, "r");
+    shape.params = glm::vec4(getSvgNumber(attributes, count, "cx"),
+                             getSvgNumber(attributes, count, "cy"), r, r);
+  } else if (tag == "ellipse") {
+    shape.kind = SVG_ELLIPSE;
+    shape.params = glm::vec4(getSvgNumber(attributes, count, "cx"),
+                             getSvgNumber(attributes, count, "cy"),
+                             getSvgNumber(attributes, count, "rx"),
+                             getSvgNumber(attributes, count, "ry"));
+  } else if (tag == "line") {
+    shape.kind = SVG_LINE;
+    shape.params = glm::vec4(getSvgNumber(attributes, count, "x1"),
+                             getSvgNumber(attributes, count, "y1"),
+                             getSvgNumber(attributes, count, "x2"),
+                             getSvgNumber(attributes, count, "y2"));
+  } else if (tag == "polygon") {
+    shape.kind = SVG_POLYGON;
+    std::string_view text = findSvgAttribute(attributes, count, "points");
+    scratch.clear();
+    float value;
+    while (nextSvgNumber(text, value)) {
+      scratch.push_back(value);
+    }
+    shape.pointCount = scratch.size() / 2;
+    glm::vec2 *points = arena.allocateArray<glm::vec2>(shape.pointCount);
+    for (int i = 0; i < shape.pointCount; ++i) {
+      points[i] = glm::vec2(scratch[2 * i], scratch[2 * i + 1]);
+    }
+    shape.points = points;
+  } else {
+    return false;
+  }
+
+  parseSvgPaint(shape, attributes, count);
+  return true;
+}
+
+// Returns the position of the '>' that ends the markup starting at the '<'
+// at position, or npos if it is unterminated. Comments and CDATA sections
+// end at their terminators and <style> and <script> run to their closing
+// tag, so a '<' in their text is never taken for an element.
+size_t findSvgMarkupEnd(std::string_view text, size_t position) {
+  size_t nameStart = position + 1;
+  if (text.compare(nameStart, 3, "!--") == 0) {
+    size_t end = text.find("-->", nameStart + 3);
+    return end == std::string_view::npos ? end : end + 2;
+  }
+  if (text.compare(nameStart, 8, "![CDATA[") == 0) {
+    size_t end = text.find("]]>", nameStart + 8);
+    return end == std::string_view::npos ? end : end + 2;
+  }
+  size_t close = text.find('>', nameStart);
+  for (std::string_view tag : {"style", "script"}) {
+    size_t nameEnd = nameStart + tag.size();
+    if (close != std::string_view::npos && text[close - 1] != '/' &&
+        text.compare(nameStart, tag.size(), tag) == 0 && nameEnd <= close &&
+        (isSvgSpace(text[nameEnd]) || text[nameEnd] == '>')) {
+      size_t closing = text.find("</" + std::string(tag), close);
+      return closing == std::string_view::npos ? closing
+                                               : text.find('>', closing);
+    }
+  }
+  return close;
+}
+
+// Markup positions each chunk remembers for resynchronizing its start.
+const size_t SVG_CHUNK_MARKS = 1024;
+
+struct SvgChunk {
+  std::vector<SvgShape> shapes;
+  // The first markup positions parsed, each with the number of shapes found
+  // before it.
+  std::vector<std::pair<size_t, size_t>> marks;
+  // First markup at or after the end of the chunk.
+  size_t next;
+};
+
+// Parses every element that starts inside [begin, end), beginning at the
+// first '<' at or after begin. Elements may run past end. When begin falls
+// inside a comment, CDATA section or <style>, the first few elements are
+// bogus; importSvgFile drops them using chunk.marks.
+void parseSvgChunk(std::string_view text, size_t begin, size_t end,
+                   Arena &arena, SvgChunk &chunk) {
+  std::vector<float> scratch;
+  chunk.shapes.clear();
+  chunk.marks.clear();
+  size_t position = text.find('<', begin);
+  while (position < end) {
+    if (chunk.marks.size() < SVG_CHUNK_MARKS) {
+      chunk.marks.push_back({position, chunk.shapes.size()});
+    }
+    size_t close = findSvgMarkupEnd(text, position);
+    if (close == std::string_view::npos) {
+      position = close;
+      break;
+    }
+
+    size_t nameStart = position + 1;
+    size_t nameEnd = nameStart;
+    while (nameEnd < close && !isSvgSpace(text[nameEnd]) &&
+           text[nameEnd] != '/' && text[nameEnd] != '>') {
+      ++nameEnd;
+    }
+    std::string_view tag = text.substr(nameStart, nameEnd - nameStart);
+    std::string_view body =
+        text.substr(nameEnd, text.find('>', nameEnd) - nameEnd);
+
+    SvgShape shape;
+    if (parseSvgElement(tag, body, arena, scratch, shape)) {
+      chunk.shapes.push_back(shape);
+    }
+    position = text.find('<', close);
+  }
+  chunk.next = std::min(position, text.size());
+}
+
+// Chunk i starts at the first '<' after its offset, which may be inside
+// markup that began in chunk i - 1. Once a chunk reaches the markup that
+// chunk i - 1 ended on, both parse the same elements, so the shapes before
+// that point are dropped. A chunk that never reaches it is parsed again
+// from there.
+void alignSvgChunks(std::string_view text, size_t chunkSize,
+                    std::vector<Arena> &arenas,
+                    std::vector<SvgChunk> &chunks) {
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    size_t start = chunks[i - 1].next;
+    size_t end = std::min(text.size(), (i + 1) * chunkSize);
+    SvgChunk &chunk = chunks[i];
+    auto mark = std::find_if(chunk.marks.begin(), chunk.marks.end(),
+                             [start](const std::pair<size_t, size_t> &m) {
+                               return m.first == start;
+                             });
+    if (mark != chunk.marks.end()) {
+      chunk.shapes.erase(chunk.shapes.begin(),
+                         chunk.shapes.begin() + mark->second);
+    } else if (start >= end) {
+      chunk.shapes.clear();
+      chunk.next = start;
+    } else {
+      parseSvgChunk(text, start, end, arenas[i], chunk);
+    }
+  }
+}
+
+bool parseSvgRoot(std::string_view text, SvgDocument &document) {
+  size_t position = text.find("<svg");
+  if (position == std::string_view::npos) {
+    return false;
+  }
+  size_t close = text.find('>', position);
+  if (close == std::string_view::npos) {
+    return false;
+  }
+
+  const int MAX_ATTRIBUTES = 32;
+  SvgAttribute attributes[MAX_ATTRIBUTES];
+  std::string_view body = text.substr(position + 4, close - position - 4);
+  int count = parseSvgAttributes(body, attributes, MAX_ATTRIBUTES);
+
+  std::string_view viewBox = findSvgAttribute(attributes, count, "viewBox");
+  glm::vec4 box;
+  if (nextSvgNumber(viewBox, box.x) && nextSvgNumber(viewBox, box.y) &&
+      nextSvgNumber(viewBox, box.z) && nextSvgNumber(viewBox, box.w)) {
+    document.viewBox = box;
+  } else {
+    document.viewBox =
+        glm::vec4(0.0, 0.0, getSvgNumber(attributes, count, "width"),
+                  getSvgNumber(attributes, count, "height"));
+  }
+  return document.viewBox.z > 0.0 && document.viewBox.w > 0.0;
+}
+
+bool importSvgFile(const char *path, SvgDocument &document,
+                   unsigned int threadCount) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    std::cerr << "SVG file " << path << " is empty" << std::endl;
+    close(fd);
+    return false;
+  }
+  void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Cannot map " << path << std::endl;
+    return false;
+  }
+  madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+  std::string_view text((const char *)mapping, info.st_size);
+
+  if (!parseSvgRoot(text, document)) {
+    std::cerr << "SVG file " << path << " has no usable <svg> viewBox"
+              << std::endl;
+    munmap(mapping, info.st_size);
+    return false;
+  }
+
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // Small files are not worth the thread startup cost.
+  const size_t MIN_CHUNK_SIZE = 1 << 20;
+  threadCount = std::max<size_t>(
+      1, std::min<size_t>(threadCount, text.size() / MIN_CHUNK_SIZE));
+
+  document.arenas.clear();
+  document.arenas.resize(threadCount);
+  std::vector<SvgChunk> chunks(threadCount);
+  std::vector<std::thread> workers;
+  size_t chunkSize = (text.size() + threadCount - 1) / threadCount;
+  for (unsigned int i = 0; i < threadCount; ++i) {
+    size_t begin = std::min(text.size(), i * chunkSize);
+    size_t end = std::min(text.size(), begin + chunkSize);
+    workers.emplace_back(parseSvgChunk, text, begin, end,
+                         std::ref(document.arenas[i]), std::ref(chunks[i]));
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  alignSvgChunks(text, chunkSize, document.arenas, chunks);
+  munmap(mapping, info.st_size);
+
+  size_t total = document.shapes.size();
+  for (const SvgChunk &chunk : chunks) {
+    total += chunk.shapes.size();
+  }
+  document.shapes.reserve(total);
+  for (const SvgChunk &chunk : chunks) {
+    document.shapes.insert(document.shapes.end(), chunk.shapes.begin(),
+                           chunk.shapes.end());
+  }
+  return true;
+}
+
+glm::mat3 getSvgToWorld(const SvgDocument &document) {
+  glm::vec2 origin(document.viewBox.x, document.viewBox.y);
+  glm::vec2 size(document.viewBox.z, document.viewBox.w);
+  float scale = 2.0f / std::max(size.x, size.y);
+  glm::vec2 center = origin + size * 0.5f;
+
+  glm::mat3 transform(1.0f);
+  transform[0][0] = scale;
+  transform[1][1] = -scale;
+  transform[2] = glm::vec3(-center.x * scale, center.y * scale, 1.0);
+  return transform;
+}
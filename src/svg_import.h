@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "arena.h"
+
+enum SvgShapeKind { SVG_RECT, SVG_CIRCLE, SVG_ELLIPSE, SVG_LINE, SVG_POLYGON };
+
+// One element of the supported SVG subset, in SVG user units (y down).
+// params holds x, y, width, height for rects, cx, cy, rx, ry for circles and
+// ellipses and x1, y1, x2, y2 for lines. Polygon points live in the owning
+// document's arenas.
+struct SvgShape {
+  SvgShapeKind kind;
+  glm::vec4 params;
+  const glm::vec2 *points;
+  int pointCount;
+  bool filled;
+  glm::vec3 fill;
+  glm::vec3 stroke;
+  float strokeWidth;
+};
+
+struct SvgDocument {
+  glm::vec4 viewBox;
+  std::vector<SvgShape> shapes;
+  std::vector<Arena> arenas;
+};
+
+// Parses rect, circle, ellipse, line and polygon elements with fill, stroke
+// and stroke-width attributes (or the same properties in style). Groups,
+// transforms, paths and CSS are ignored. The file is split into chunks at
+// element boundaries and parsed on threadCount workers (0 = one per core);
+// shapes keep document order.
+bool importSvgFile(const char *path, SvgDocument &document,
+                   unsigned int threadCount = 0);
+
+// Maps the document's viewBox onto [-1, 1] with y pointing up, preserving
+// the aspect ratio.
+glm::mat3 getSvgToWorld(const SvgDocument &document);
@@ -6,9 +6,38 @@
 #include <cmath>
 #include <string>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/matrix_transform_2d.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "procedural_batch.h"
+#include "aligned_vector.h"
+#include "bvh.h"
+#include "camera.h"
+#include "frame_capture.h"
+#include "frame_target.h"
+#include "job_system.h"
+#include "line_batch.h"
+#include "lockfree_queue.h"
+#include "scene_file.h"
+#include "scene_graph.h"
+#include "shader_program.h"
+#include "shader_reloader.h"
+#include "sdf_batch.h"
+#include "shape_culler.h"
+#include "svg_import.h"
+#include "shape_batch.h"
+#include "triangulate.h"
 
 const glm::vec3 WHITE(1.0, 1.0, 1.0);
 const glm::vec3 BLACK(0.0, 0.0, 0.0);
@@ -21,68 +50,63 @@ const int TRIANGLE_NUM_POINTS = 3;
 const int SQUARE_NUM = 6;
 const int SQUARE_NUM_POINTS = 4 * SQUARE_NUM;
 const int LINE_NUM_POINTS = 2;
+const int STRESS_NUM_POINTS = 12;
+const int IMPORT_ELLIPSE_NUM_POINTS = 32;
+const int STREAM_CHUNK_SHAPES = 4096;
+const int STREAM_QUEUE_SIZE = 64;
+const int STREAM_CHUNKS_PER_FRAME = 8;
+const float LINE_WIDTH = 2.0;
+const glm::vec2 TRIANGLE_CENTER(0.0, 0.70);
+const glm::vec2 SQUARE_CENTER(0.0, -0.25);
+const glm::vec2 CIRCLE_CENTER(0.65, 0.70);
+const glm::vec2 ELLIPSE_CENTER(-0.65, 0.70);
+
+// Per-shape record in the shader storage buffer, indexed in the vertex shader
+// by gl_BaseInstance + gl_InstanceID. Layout matches std430. Entry i holds the
+// world transform of scene graph node i.
+struct ShapeData {
+  glm::mat4 transform;
+  glm::vec4 color;
+};
+
+// Scene graph nodes of the picture. Stress ellipses are appended after
+// SHAPE_COUNT as children of SHAPE_STRESS.
+enum ShapeId {
+  SHAPE_TRIANGLE,
+  SHAPE_SQUARES,
+  SHAPE_LINE,
+  SHAPE_CIRCLE,
+  SHAPE_ELLIPSE,
+  SHAPE_IMPORT,
+  SHAPE_STRESS,
+  SHAPE_COUNT
+};
 
 std::string readFile(const char *filename) {
-  std::ifstream in(filename);
-  if (!in) {
-    std::cerr << "Cannot open " << filename << std::endl;
+  std::string source;
+  if (!readShaderFile(filename, source)) {
     exit(EXIT_FAILURE);
   }
-  std::stringstream ss;
-  ss << in.rdbuf();
-  return ss.str();
+  return source;
 }
 
 GLuint InitShader(const char *vShaderFile, const char *fShaderFile) {
   std::string vsrc = readFile(vShaderFile);
   std::string fsrc = readFile(fShaderFile);
-
-  const char *vShaderSrc = vsrc.c_str();
-  const char *fShaderSrc = fsrc.c_str();
-
-  GLuint vShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vShader, 1, &vShaderSrc, NULL);
-  glCompileShader(vShader);
-
-  GLint compiled;
-  glGetShaderiv(vShader, GL_COMPILE_STATUS, &compiled);
-  if (!compiled) {
-    char log[1024];
-    glGetShaderInfoLog(vShader, 1024, NULL, log);
-    std::cerr << "Vertex shader compile error:\n" << log << std::endl;
-  }
-
-  GLuint fShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fShader, 1, &fShaderSrc, NULL);
-  glCompileShader(fShader);
-
-  glGetShaderiv(fShader, GL_COMPILE_STATUS, &compiled);
-  if (!compiled) {
-    char log[1024];
-    glGetShaderInfoLog(fShader, 1024, NULL, log);
-    std::cerr << "Fragment shader compile error:\n" << log << std::endl;
-  }
-
-  GLuint program = glCreateProgram();
-  glAttachShader(program, vShader);
-  glAttachShader(program, fShader);
-  glLinkProgram(program);
-
-  GLint linked;
-  glGetProgramiv(program, GL_LINK_STATUS, &linked);
-  if (!linked) {
-    char log[1024];
-    glGetProgramInfoLog(program, 1024, NULL, log);
-    std::cerr << "Shader program link error:\n" << log << std::endl;
-  }
-
-  glDeleteShader(vShader);
-  glDeleteShader(fShader);
-  return program;
+  return compileProgram(vsrc, fsrc);
 }
 
+Camera2D camera;
+bool cameraDirty = true;
+bool dragging = false;
+glm::vec2 lastCursor;
+FrameTarget frameTarget;
+
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
+  frameTarget.resize(width, height);
+  cameraDirty = true;
 }
 
 float generateAngleColor(double angle) { return 1.0 / (2 * M_PI) * angle; }
@@ -100,15 +124,17 @@ glm::vec2 getEllipseVertex(glm::vec2 center, double scale, double verticalScale,
   return vertex;
 }
 
-void generateEllipsePoints(glm::vec2 vertices[], glm::vec3 colors[],
+AABB generateEllipsePoints(glm::vec2 vertices[], glm::vec3 colors[],
                            int startVertexIndex, int numPoints,
                            glm::vec2 center, double scale,
                            double verticalScale) {
   double angleIncrement = (2 * M_PI) / numPoints;
   double currentAngle = M_PI / 2;
+  AABB bounds = emptyAABB();
 
   for (int i = startVertexIndex; i < startVertexIndex + numPoints; ++i) {
     vertices[i] = getEllipseVertex(center, scale, verticalScale, currentAngle);
+    expandAABB(bounds, vertices[i]);
     if (verticalScale == 1.0) {
       colors[i] = glm::vec3(generateAngleColor(currentAngle), 0.0, 0.0);
     } else {
@@ -116,30 +142,34 @@ void generateEllipsePoints(glm::vec2 vertices[], glm::vec3 colors[],
     }
     currentAngle += angleIncrement;
   }
+  return bounds;
 }
 
-void generateTrianglePoints(glm::vec2 vertices[], glm::vec3 colors[],
+AABB generateTrianglePoints(glm::vec2 vertices[], glm::vec3 colors[],
                             int startVertexIndex) {
   glm::vec2 scale(0.25, 0.25);
-  glm::vec2 center(0.0, 0.70);
+  AABB bounds = emptyAABB();
 
   for (int i = 0; i < 3; ++i) {
     double currentAngle = getTriangleAngle(i);
     vertices[startVertexIndex + i] =
-        glm::vec2(sin(currentAngle), cos(currentAngle)) * scale + center;
+        glm::vec2(sin(currentAngle), cos(currentAngle)) * scale +
+        TRIANGLE_CENTER;
+    expandAABB(bounds, vertices[startVertexIndex + i]);
   }
 
   colors[startVertexIndex] = RED;
   colors[startVertexIndex + 1] = GREEN;
   colors[startVertexIndex + 2] = BLUE;
+  return bounds;
 }
 
-void generateSquarePoints(glm::vec2 vertices[], glm::vec3 colors[],
+AABB generateSquarePoints(glm::vec2 vertices[], glm::vec3 colors[],
                           int squareNumber, int startVertexIndex) {
   glm::vec2 scale(0.90, 0.90);
   double scaleDecrease = 0.15;
-  glm::vec2 center(0.0, -0.25);
   int vertexIndex = startVertexIndex;
+  AABB bounds = emptyAABB();
 
   for (int i = 0; i < squareNumber; ++i) {
     glm::vec3 currentColor;
@@ -147,180 +177,928 @@ void generateSquarePoints(glm::vec2 vertices[], glm::vec3 colors[],
     for (int j = 0; j < 4; ++j) {
       double currentAngle = getSquareAngle(j);
       vertices[vertexIndex] =
-          glm::vec2(sin(currentAngle), cos(currentAngle)) * scale + center;
+          glm::vec2(sin(currentAngle), cos(currentAngle)) * scale +
+          SQUARE_CENTER;
       colors[vertexIndex] = currentColor;
+      expandAABB(bounds, vertices[vertexIndex]);
       vertexIndex++;
     }
     scale -= scaleDecrease;
   }
+  return bounds;
 }
 
-void generateLinePoints(glm::vec2 vertices[], glm::vec3 colors[],
+AABB generateLinePoints(glm::vec2 vertices[], glm::vec3 colors[],
                         int startVertexIndex) {
   vertices[startVertexIndex] = glm::vec2(-1.0, -1.0);
   vertices[startVertexIndex + 1] = glm::vec2(1.0, 1.0);
 
   colors[startVertexIndex] = WHITE;
   colors[startVertexIndex + 1] = BLUE;
+
+  AABB bounds = emptyAABB();
+  expandAABB(bounds, vertices[startVertexIndex]);
+  expandAABB(bounds, vertices[startVertexIndex + 1]);
+  return bounds;
 }
 
-GLuint vao[5], program;
+AABB generateRectPoints(glm::vec2 vertices[], glm::vec3 colors[],
+                        int startVertexIndex, glm::vec2 corner, glm::vec2 size,
+                        glm::vec3 color) {
+  const glm::vec2 offsets[4] = {glm::vec2(0.0, 0.0), glm::vec2(1.0, 0.0),
+                                glm::vec2(1.0, 1.0), glm::vec2(0.0, 1.0)};
+  AABB bounds = emptyAABB();
+
+  for (int i = 0; i < 4; ++i) {
+    vertices[startVertexIndex + i] = corner + offsets[i] * size;
+    colors[startVertexIndex + i] = color;
+    expandAABB(bounds, vertices[startVertexIndex + i]);
+  }
+  return bounds;
+}
 
-void init() {
+AABB generateThickLinePoints(glm::vec2 vertices[], glm::vec3 colors[],
+                             int startVertexIndex, glm::vec2 from,
+                             glm::vec2 to, double width, glm::vec3 color) {
+  glm::vec2 direction = glm::normalize(to - from);
+  glm::vec2 offset = glm::vec2(-direction.y, direction.x) * (float)(width / 2);
+  AABB bounds = emptyAABB();
+
+  vertices[startVertexIndex] = from + offset;
+  vertices[startVertexIndex + 1] = to + offset;
+  vertices[startVertexIndex + 2] = to - offset;
+  vertices[startVertexIndex + 3] = from - offset;
+  for (int i = 0; i < 4; ++i) {
+    colors[startVertexIndex + i] = color;
+    expandAABB(bounds, vertices[startVertexIndex + i]);
+  }
+  return bounds;
+}
+
+// Triangulates a possibly concave polygon with holes into indexed triangles
+// of one color, ordered for the vertex cache.
+AABB generatePolygonPoints(aligned_vector<glm::vec2> &vertices,
+                           aligned_vector<glm::vec3> &colors,
+                           std::vector<GLuint> &indices,
+                           const std::vector<PolygonRing> &rings,
+                           glm::vec3 color) {
+  AABB bounds = emptyAABB();
+  if (!triangulatePolygon(rings, vertices, indices)) {
+    return bounds;
+  }
+  optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+
+  colors.assign(vertices.size(), color);
+  for (const glm::vec2 &vertex : vertices) {
+    expandAABB(bounds, vertex);
+  }
+  return bounds;
+}
+
+PolygonParams getEllipseParams(glm::vec2 center, double scale,
+                               double verticalScale, int numPoints,
+                               GLuint shapeIndex) {
+  PolygonParams polygon;
+  polygon.center = center;
+  polygon.radius = glm::vec2(scale, scale * verticalScale);
+  polygon.startAngle = M_PI / 2;
+  polygon.segments = numPoints;
+  polygon.colorRule = (verticalScale == 1.0) ? COLOR_ANGLE : COLOR_SOLID;
+  polygon.shapeIndex = shapeIndex;
+  polygon.color = glm::vec4(RED, 1.0);
+  return polygon;
+}
+
+std::vector<PolygonParams> getEllipses(int stressCount, double stressScale) {
+  std::vector<PolygonParams> ellipses;
+  ellipses.push_back(getEllipseParams(CIRCLE_CENTER, 0.25, 1.0,
+                                      CIRCLE_NUM_POINTS, SHAPE_CIRCLE));
+  ellipses.push_back(getEllipseParams(ELLIPSE_CENTER, 0.25, 0.50,
+                                      ELLIPSE_NUM_POINTS, SHAPE_ELLIPSE));
+
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<double> position(-1.0, 1.0);
+  std::uniform_real_distribution<double> scale(0.005, 0.02);
+  std::uniform_int_distribution<int> round(0, 1);
+  std::uniform_real_distribution<double> verticalScale(0.5, 1.0);
+
+  for (int i = 0; i < stressCount; ++i) {
+    glm::vec2 center(position(rng), position(rng));
+    double ellipseScale = scale(rng) * stressScale;
+    double ellipseVerticalScale = round(rng) ? 1.0 : verticalScale(rng);
+    ellipses.push_back(getEllipseParams(center, ellipseScale,
+                                        ellipseVerticalScale,
+                                        STRESS_NUM_POINTS, SHAPE_COUNT + i));
+  }
+  return ellipses;
+}
+
+GLuint program, proceduralProgram, sdfProgram, lineProgram;
+ShapeBatch batch;
+LineBatch lineBatch;
+ProceduralBatch proceduralBatch;
+SdfBatch sdfBatch;
+GLuint cameraBuffer;
+ShapeCuller culler, sdfCuller;
+MappedSceneFile sceneMapping;
+const char *sceneFile = NULL;
+SvgDocument svgDocument;
+const char *svgFile = NULL;
+const char *exportSceneFile = NULL;
+std::vector<int> visibleShapes;
+bool cullingDirty = true;
+GLuint shapeBuffer;
+SceneGraph sceneGraph;
+std::vector<ShapeData> shapes;
+bool animate = false;
+bool procedural = false;
+bool sdf = false;
+int stressShapes = 0;
+double stressScale = 1.0;
+int stressLines = 0;
+float lineWidth = LINE_WIDTH;
+int benchFrames = 0;
+GLuint fxaaProgram = 0;
+AntialiasMode antialiasMode = AA_OFF;
+int antialiasSamples = 0;
+int antialiasBenchFrames = 0;
+FrameCapture frameCapture;
+const char *capturePattern = NULL;
+int captureFrames = 0;
+ShaderReloader shaderReloader;
+bool watchShaders = false;
+bool syncGeometry = false;
+
+// Stress ellipses tessellated on a worker thread, in batch layout.
+struct StreamChunk {
+  GeometryChunk geometry;
+  std::vector<AABB> bounds;
+};
+
+std::unique_ptr<JobSystem> jobs;
+LockFreeQueue<StreamChunk *> finishedChunks(STREAM_QUEUE_SIZE);
+std::vector<PolygonParams> streamedEllipses;
+int streamingChunks = 0;
+std::atomic<bool> streamingCancelled(false);
+
+void watchShader(GLuint *program, const std::string &vShaderFile,
+                 const std::string &fShaderFile) {
+  if (watchShaders) {
+    shaderReloader.watch(program, vShaderFile.c_str(), fShaderFile.c_str());
+  }
+}
+
+void uploadShapes(int first, int last) {
+  for (int i = first; i <= last; ++i) {
+    shapes[i].transform = toMat4(sceneGraph.getWorld(i));
+  }
+
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, shapeBuffer);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(ShapeData),
+                  (last - first + 1) * sizeof(ShapeData), &shapes[first]);
+}
+
+void initShapeBuffer() {
+  for (int i = 0; i < SHAPE_COUNT; ++i) {
+    sceneGraph.addNode(-1);
+  }
+  int nodeCount = SHAPE_COUNT + stressShapes;
+  if (sceneFile) {
+    nodeCount = std::max<int>(nodeCount, sceneMapping.getHeader().nodeCount);
+  }
+  for (int i = SHAPE_COUNT; i < nodeCount; ++i) {
+    sceneGraph.addNode(SHAPE_STRESS);
+  }
+
+  int first, last;
+  sceneGraph.update(first, last);
+
+  shapes.resize(sceneGraph.size());
+  for (int i = 0; i < sceneGraph.size(); ++i) {
+    shapes[i].transform = toMat4(sceneGraph.getWorld(i));
+    shapes[i].color = glm::vec4(WHITE, 1.0);
+  }
+
+  glGenBuffers(1, &shapeBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, shapeBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, shapes.size() * sizeof(ShapeData),
+               shapes.data(), GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, shapeBuffer);
+}
+
+void updateShapes(double time) {
+  glm::mat3 spin = glm::translate(glm::mat3(1.0f), TRIANGLE_CENTER);
+  spin = glm::rotate(spin, (float)time);
+  sceneGraph.setLocal(SHAPE_TRIANGLE,
+                      toAffine2(glm::translate(spin, -TRIANGLE_CENTER)));
+
+  // Moving the stress group moves all of its children in the same pass.
+  glm::vec2 sway(0.1 * sin(time), 0.0);
+  Affine2 swayTransform = identityAffine2();
+  swayTransform.t = sway;
+  sceneGraph.setLocal(SHAPE_STRESS, swayTransform);
+
+  float pulse = 0.5 + 0.5 * sin(time * 2.0);
+  shapes[SHAPE_ELLIPSE].color = glm::vec4(pulse, pulse, pulse, 1.0);
+
+  int first, last;
+  if (sceneGraph.update(first, last)) {
+    // Streamed shapes have no world bounds yet; the culler is rebuilt once
+    // they have all arrived.
+    if (streamingChunks == 0) {
+      culler.refit(sceneGraph, first, last);
+    }
+    sdfCuller.refit(sceneGraph, first, last);
+    cullingDirty = true;
+  } else {
+    first = last = SHAPE_ELLIPSE;
+  }
+  uploadShapes(std::min<int>(first, SHAPE_ELLIPSE),
+               std::max<int>(last, SHAPE_ELLIPSE));
+}
+
+void initCameraBuffer() {
+  glGenBuffers(1, &cameraBuffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraData), NULL, GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BUFFER_BINDING, cameraBuffer);
+}
+
+void updateCamera() {
+  if (!cameraDirty) {
+    return;
+  }
+
+  CameraData data;
+  data.viewProjection = camera.getViewProjection();
+  glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraData), &data);
+
+  cameraDirty = false;
+  cullingDirty = true;
+}
+
+void loadSceneFile() {
+  // Geometry goes from the mapping straight into buffer storage; only the
+  // shape table is copied for culling.
+  const SceneFileHeader &header = sceneMapping.getHeader();
+  batch.uploadExternal(program, sceneMapping.getVertices(), header.vertexCount,
+                       sceneMapping.getIndices(), header.indexCount,
+                       sceneMapping.getCommands(), header.shapeCount);
+
+  const DrawElementsIndirectCommand *commands = sceneMapping.getCommands();
+  const SceneShape *shapes = sceneMapping.getShapes();
+  for (uint32_t i = 0; i < header.shapeCount; ++i) {
+    culler.add(shapes[i].bounds, commands[i].baseInstance);
+  }
+  sceneMapping.close();
+}
+
+// Tessellates imported SVG shapes in SVG units, then maps them into the scene
+// so the batch (and any exported scene file) holds world coordinates.
+void loadSvgDocument() {
+  glm::mat3 svgToWorld = getSvgToWorld(svgDocument);
+  aligned_vector<glm::vec2> vertices;
+  aligned_vector<glm::vec3> colors;
+  std::vector<GLuint> indices;
+
+  for (const SvgShape &shape : svgDocument.shapes) {
+    int numPoints = 0;
+    AABB bounds;
+    indices.clear();
+    if (shape.kind == SVG_RECT && shape.filled) {
+      numPoints = 4;
+      vertices.resize(numPoints);
+      colors.resize(numPoints);
+      bounds = generateRectPoints(vertices.data(), colors.data(), 0,
+                                  glm::vec2(shape.params.x, shape.params.y),
+                                  glm::vec2(shape.params.z, shape.params.w),
+                                  shape.fill);
+    } else if ((shape.kind == SVG_CIRCLE || shape.kind == SVG_ELLIPSE) &&
+               shape.filled && shape.params.z > 0.0) {
+      numPoints = IMPORT_ELLIPSE_NUM_POINTS;
+      vertices.resize(numPoints);
+      colors.resize(numPoints);
+      bounds = generateEllipsePoints(
+          vertices.data(), colors.data(), 0, numPoints,
+          glm::vec2(shape.params.x, shape.params.y), shape.params.z,
+          shape.params.w / shape.params.z);
+      std::fill(colors.begin(), colors.end(), shape.fill);
+    } else if (shape.kind == SVG_POLYGON && shape.filled) {
+      // Map outlines are often concave, so they cannot be drawn as fans.
+      bounds = generatePolygonPoints(vertices, colors, indices,
+                                     {{shape.points, shape.pointCount}},
+                                     shape.fill);
+      numPoints = indices.empty() ? 0 : vertices.size();
+    } else if (shape.kind == SVG_LINE && shape.strokeWidth > 0.0) {
+      glm::vec2 from(shape.params.x, shape.params.y);
+      glm::vec2 to(shape.params.z, shape.params.w);
+      if (from == to) {
+        continue;
+      }
+      numPoints = 4;
+      vertices.resize(numPoints);
+      colors.resize(numPoints);
+      bounds = generateThickLinePoints(vertices.data(), colors.data(), 0, from,
+                                       to, shape.strokeWidth, shape.stroke);
+    }
+
+    if (numPoints >= 3) {
+      for (glm::vec2 &vertex : vertices) {
+        vertex = glm::vec2(svgToWorld * glm::vec3(vertex, 1.0));
+      }
+      if (indices.empty()) {
+        batch.addTriangleFan(vertices.data(), colors.data(), numPoints,
+                             SHAPE_IMPORT);
+      } else {
+        batch.addIndexedTriangles(vertices.data(), colors.data(), numPoints,
+                                  indices.data(), indices.size(),
+                                  SHAPE_IMPORT);
+      }
+      culler.add(transformAABB(svgToWorld, bounds), SHAPE_IMPORT);
+    }
+  }
+
+  // Polygon points live in the arenas and are no longer needed.
+  svgDocument = SvgDocument();
+}
+
+void addPictureShapes() {
   glm::vec2 triangle_vertices[TRIANGLE_NUM_POINTS];
   glm::vec3 triangle_colors[TRIANGLE_NUM_POINTS];
 
   glm::vec2 square_vertices[SQUARE_NUM_POINTS];
   glm::vec3 square_colors[SQUARE_NUM_POINTS];
 
-  glm::vec2 circle_vertices[CIRCLE_NUM_POINTS];
-  glm::vec3 circle_colors[CIRCLE_NUM_POINTS];
+  AABB triangle_bounds =
+      generateTrianglePoints(triangle_vertices, triangle_colors, 0);
+  AABB square_bounds =
+      generateSquarePoints(square_vertices, square_colors, SQUARE_NUM, 0);
 
-  glm::vec2 ellipse_vertices[ELLIPSE_NUM_POINTS];
-  glm::vec3 ellipse_colors[ELLIPSE_NUM_POINTS];
+  batch.addTriangles(triangle_vertices, triangle_colors, TRIANGLE_NUM_POINTS,
+                     SHAPE_TRIANGLE);
+  culler.add(triangle_bounds, SHAPE_TRIANGLE);
+  for (int i = 0; i < SQUARE_NUM; ++i) {
+    batch.addTriangleFan(&square_vertices[i * 4], &square_colors[i * 4], 4,
+                         SHAPE_SQUARES);
+    culler.add(square_bounds, SHAPE_SQUARES);
+  }
+  if (!sdf) {
+    std::vector<PolygonParams> ellipses =
+        getEllipses(stressShapes, stressScale);
+    // The picture is drawn on the first frame; stress ellipses follow from
+    // the worker threads. An exported scene needs all of them up front.
+    if (!syncGeometry && !exportSceneFile) {
+      streamedEllipses.assign(ellipses.begin() + 2, ellipses.end());
+      ellipses.resize(2);
+    }
 
-  generateTrianglePoints(triangle_vertices, triangle_colors, 0);
-  generateSquarePoints(square_vertices, square_colors, SQUARE_NUM, 0);
+    aligned_vector<glm::vec2> ellipse_vertices;
+    aligned_vector<glm::vec3> ellipse_colors;
+    for (const PolygonParams &ellipse : ellipses) {
+      ellipse_vertices.resize(ellipse.segments);
+      ellipse_colors.resize(ellipse.segments);
+      AABB bounds = generateEllipsePoints(
+          ellipse_vertices.data(), ellipse_colors.data(), 0, ellipse.segments,
+          ellipse.center, ellipse.radius.x, ellipse.radius.y / ellipse.radius.x);
+      batch.addTriangleFan(ellipse_vertices.data(), ellipse_colors.data(),
+                           ellipse.segments, ellipse.shapeIndex);
+      culler.add(bounds, ellipse.shapeIndex);
+    }
+  }
+}
 
-  glm::vec2 circle_center(0.65, 0.70);
-  generateEllipsePoints(circle_vertices, circle_colors, 0, CIRCLE_NUM_POINTS,
-                        circle_center, 0.25, 1.0);
+void generateEllipseChunk(int first, int last) {
+  if (streamingCancelled) {
+    return;
+  }
+  StreamChunk *chunk = new StreamChunk;
+  aligned_vector<glm::vec2> vertices;
+  aligned_vector<glm::vec3> colors;
+  for (int i = first; i < last; ++i) {
+    // Shutdown joins the workers, so stop tessellating as soon as it starts.
+    if (streamingCancelled) {
+      delete chunk;
+      return;
+    }
+    const PolygonParams &ellipse = streamedEllipses[i];
+    vertices.resize(ellipse.segments);
+    colors.resize(ellipse.segments);
+    chunk->bounds.push_back(generateEllipsePoints(
+        vertices.data(), colors.data(), 0, ellipse.segments, ellipse.center,
+        ellipse.radius.x, ellipse.radius.y / ellipse.radius.x));
+    chunk->geometry.addTriangleFan(vertices.data(), colors.data(),
+                                   ellipse.segments, ellipse.shapeIndex);
+  }
 
-  glm::vec2 ellipse_center(-0.65, 0.70);
-  generateEllipsePoints(ellipse_vertices, ellipse_colors, 0, ELLIPSE_NUM_POINTS,
-                        ellipse_center, 0.25, 0.50);
+  // A full queue means the render thread is behind; wait for it to drain.
+  while (!finishedChunks.push(chunk)) {
+    if (streamingCancelled) {
+      delete chunk;
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
 
+void startStreaming() {
+  if (streamedEllipses.empty()) {
+    return;
+  }
+
+  jobs = std::make_unique<JobSystem>();
+  for (int first = 0; first < (int)streamedEllipses.size();
+       first += STREAM_CHUNK_SHAPES) {
+    int last =
+        std::min<int>(first + STREAM_CHUNK_SHAPES, streamedEllipses.size());
+    jobs->submit([first, last] { generateEllipseChunk(first, last); });
+    streamingChunks++;
+  }
+}
+
+// Appends a few finished chunks per frame so uploads never stall rendering.
+// The batch draws every command until the last chunk arrives, then culling
+// takes over again.
+void streamShapes() {
+  StreamChunk *chunk;
+  for (int i = 0; i < STREAM_CHUNKS_PER_FRAME && streamingChunks > 0 &&
+                  finishedChunks.pop(chunk);
+       ++i) {
+    batch.appendChunk(chunk->geometry);
+    for (size_t j = 0; j < chunk->bounds.size(); ++j) {
+      culler.add(chunk->bounds[j], chunk->geometry.commands[j].baseInstance);
+    }
+    delete chunk;
+
+    if (--streamingChunks == 0) {
+      jobs.reset();
+      streamedEllipses = std::vector<PolygonParams>();
+      culler.build(sceneGraph);
+      cullingDirty = true;
+    }
+  }
+}
+
+void stopStreaming() {
+  streamingCancelled = true;
+  jobs.reset();
+
+  StreamChunk *chunk;
+  while (finishedChunks.pop(chunk)) {
+    delete chunk;
+  }
+  streamingChunks = 0;
+}
+
+void initTessellated() {
   std::string vshader, fshader;
   vshader = "shaders/vertex_shader_task2.glsl";
   fshader = "shaders/fragment_shader.glsl";
   program = InitShader(vshader.c_str(), fshader.c_str());
-  glUseProgram(program);
-
-  GLuint vbo[2];
-
-  glGenVertexArrays(1, &vao[0]);
-  glBindVertexArray(vao[0]);
-
-  glGenBuffers(1, &vbo[0]);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(triangle_vertices), triangle_vertices,
-               GL_STATIC_DRAW);
-  GLuint location = glGetAttribLocation(program, "vPosition");
-  glEnableVertexAttribArray(location);
-  glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
-                        BUFFER_OFFSET(0));
-
-  glGenBuffers(1, &vbo[1]);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(triangle_colors), triangle_colors,
-               GL_STATIC_DRAW);
-  GLuint cLocation = glGetAttribLocation(program, "vColor");
-  glEnableVertexAttribArray(cLocation);
-  glVertexAttribPointer(cLocation, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                        BUFFER_OFFSET(0));
-
-  glGenVertexArrays(1, &vao[1]);
-  glBindVertexArray(vao[1]);
-
-  glGenBuffers(1, &vbo[0]);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(square_vertices), square_vertices,
-               GL_STATIC_DRAW);
-  location = glGetAttribLocation(program, "vPosition");
-  glEnableVertexAttribArray(location);
-  glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
-                        BUFFER_OFFSET(0));
-
-  glGenBuffers(1, &vbo[1]);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(square_colors), square_colors,
-               GL_STATIC_DRAW);
-  cLocation = glGetAttribLocation(program, "vColor");
-  glEnableVertexAttribArray(cLocation);
-  glVertexAttribPointer(cLocation, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                        BUFFER_OFFSET(0));
-
-  glGenVertexArrays(1, &vao[3]);
-
-  glBindVertexArray(vao[3]);
-
-  glGenBuffers(1, &vbo[0]);
-
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(circle_vertices), circle_vertices,
-               GL_STATIC_DRAW);
-  location = glGetAttribLocation(program, "vPosition");
-
-  glEnableVertexAttribArray(location);
-
-  glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
-                        BUFFER_OFFSET(0));
-
-  glGenBuffers(1, &vbo[1]);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(circle_colors), circle_colors,
-               GL_STATIC_DRAW);
-  cLocation = glGetAttribLocation(program, "vColor");
-  glEnableVertexAttribArray(cLocation);
-  glVertexAttribPointer(cLocation, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                        BUFFER_OFFSET(0));
-
-  glGenVertexArrays(1, &vao[4]);
-  glBindVertexArray(vao[4]);
-
-  glGenBuffers(1, &vbo[0]);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(ellipse_vertices), ellipse_vertices,
-               GL_STATIC_DRAW);
-  location = glGetAttribLocation(program, "vPosition");
-  glEnableVertexAttribArray(location);
-  glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
-                        BUFFER_OFFSET(0));
-
-  glGenBuffers(1, &vbo[1]);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(ellipse_colors), ellipse_colors,
-               GL_STATIC_DRAW);
-  cLocation = glGetAttribLocation(program, "vColor");
-  glEnableVertexAttribArray(cLocation);
-  glVertexAttribPointer(cLocation, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                        BUFFER_OFFSET(0));
+  watchShader(&program, vshader, fshader);
+
+  if (sceneFile) {
+    loadSceneFile();
+    return;
+  }
+
+  if (svgFile) {
+    loadSvgDocument();
+  } else {
+    addPictureShapes();
+  }
+  batch.upload(program);
+
+  if (exportSceneFile &&
+      writeSceneFile(exportSceneFile, sceneGraph.size(), batch.getCommands(),
+                     culler.getLocalBounds(), batch.getVertices(),
+                     batch.getIndices())) {
+    std::cout << "Wrote scene to " << exportSceneFile << std::endl;
+  }
+}
+
+void initProcedural() {
+  std::string vshader, fshader;
+  vshader = "shaders/vertex_shader_procedural.glsl";
+  fshader = "shaders/fragment_shader.glsl";
+  proceduralProgram = InitShader(vshader.c_str(), fshader.c_str());
+  watchShader(&proceduralProgram, vshader, fshader);
+
+  PolygonParams triangle;
+  triangle.center = TRIANGLE_CENTER;
+  triangle.radius = glm::vec2(0.25, 0.25);
+  triangle.startAngle = getTriangleAngle(0);
+  triangle.segments = TRIANGLE_NUM_POINTS;
+  triangle.colorRule = COLOR_CORNERS;
+  triangle.shapeIndex = SHAPE_TRIANGLE;
+  triangle.color = glm::vec4(WHITE, 1.0);
+  proceduralBatch.add(triangle);
+  culler.add(getPolygonBounds(triangle), triangle.shapeIndex);
+
+  glm::vec2 scale(0.90, 0.90);
+  for (int i = 0; i < SQUARE_NUM; ++i) {
+    PolygonParams square;
+    square.center = SQUARE_CENTER;
+    square.radius = scale;
+    square.startAngle = getSquareAngle(0);
+    square.segments = 4;
+    square.colorRule = COLOR_SOLID;
+    square.shapeIndex = SHAPE_SQUARES;
+    square.color = glm::vec4((i % 2) ? BLACK : WHITE, 1.0);
+    proceduralBatch.add(square);
+    culler.add(getPolygonBounds(square), square.shapeIndex);
+    scale -= 0.15;
+  }
+
+  if (!sdf) {
+    for (const PolygonParams &ellipse : getEllipses(stressShapes, stressScale)) {
+      proceduralBatch.add(ellipse);
+      culler.add(getPolygonBounds(ellipse), ellipse.shapeIndex);
+    }
+  }
+  proceduralBatch.upload();
+}
+
+void initSdf() {
+  std::string vshader, fshader;
+  vshader = "shaders/vertex_shader_sdf.glsl";
+  fshader = "shaders/fragment_shader_sdf.glsl";
+  sdfProgram = InitShader(vshader.c_str(), fshader.c_str());
+  watchShader(&sdfProgram, vshader, fshader);
+
+  for (const PolygonParams &ellipse : getEllipses(stressShapes, stressScale)) {
+    sdfBatch.add(ellipse);
+    sdfCuller.add(getPolygonBounds(ellipse), ellipse.shapeIndex);
+  }
+  sdfBatch.upload(sdfProgram);
+}
+
+void initLines() {
+  std::string vshader, fshader;
+  vshader = "shaders/vertex_shader_line.glsl";
+  fshader = "shaders/fragment_shader_line.glsl";
+  lineProgram = InitShader(vshader.c_str(), fshader.c_str());
+  watchShader(&lineProgram, vshader, fshader);
+
+  glm::vec2 line_vertices[LINE_NUM_POINTS];
+  glm::vec3 line_colors[LINE_NUM_POINTS];
+  if (!svgFile && !sceneFile) {
+    generateLinePoints(line_vertices, line_colors, 0);
+    lineBatch.addPolyline(line_vertices, line_colors, LINE_NUM_POINTS,
+                          lineWidth, CAP_ROUND, SHAPE_LINE);
+  }
+
+  std::mt19937 rng(2319);
+  std::uniform_real_distribution<double> position(-1.0, 1.0);
+  std::uniform_real_distribution<double> length(-0.05, 0.05);
+  std::uniform_real_distribution<double> channel(0.0, 1.0);
+  for (int i = 0; i < stressLines; ++i) {
+    line_vertices[0] = glm::vec2(position(rng), position(rng));
+    line_vertices[1] = line_vertices[0] + glm::vec2(length(rng), length(rng));
+    line_colors[0] = glm::vec3(channel(rng), channel(rng), channel(rng));
+    line_colors[1] = line_colors[0];
+    lineBatch.addPolyline(line_vertices, line_colors, LINE_NUM_POINTS,
+                          lineWidth, CAP_BUTT, SHAPE_LINE);
+  }
+  lineBatch.upload(lineProgram);
+}
+
+void initFrameTarget(AntialiasMode mode, int samples) {
+  if (mode == AA_FXAA && fxaaProgram == 0) {
+    fxaaProgram = InitShader("shaders/vertex_shader_fxaa.glsl",
+                             "shaders/fragment_shader_fxaa.glsl");
+    watchShader(&fxaaProgram, "shaders/vertex_shader_fxaa.glsl",
+                "shaders/fragment_shader_fxaa.glsl");
+  }
+  glm::vec2 viewport = camera.getViewportSize();
+  frameTarget.init(mode, samples, fxaaProgram, viewport.x, viewport.y);
+}
+
+void init() {
+  if (svgFile) {
+    if (!importSvgFile(svgFile, svgDocument)) {
+      exit(EXIT_FAILURE);
+    }
+    if (procedural || sdf) {
+      std::cerr << "--import tessellates on the CPU; ignoring --procedural "
+                   "and --sdf"
+                << std::endl;
+      procedural = sdf = false;
+    }
+  }
+
+  if (sceneFile) {
+    if (!sceneMapping.open(sceneFile)) {
+      exit(EXIT_FAILURE);
+    }
+    if (procedural || sdf) {
+      std::cerr << "--scene draws pre-tessellated geometry; ignoring "
+                   "--procedural and --sdf"
+                << std::endl;
+      procedural = sdf = false;
+    }
+  }
+
+  initShapeBuffer();
+  initCameraBuffer();
+
+  if (procedural) {
+    initProcedural();
+  } else {
+    initTessellated();
+  }
+
+  if (sdf) {
+    initSdf();
+  }
+  initLines();
+  initFrameTarget(antialiasMode, antialiasSamples);
+
+  culler.build(sceneGraph);
+  sdfCuller.build(sceneGraph);
+  startStreaming();
 
   glClearColor(0.0, 0.0, 0.0, 1.0);
 }
 
+void cullShapes() {
+  if (!cullingDirty) {
+    return;
+  }
+
+  AABB view = camera.getVisibleBounds();
+
+  if (streamingChunks == 0) {
+    culler.query(view, visibleShapes);
+    if (procedural) {
+      proceduralBatch.setVisible(visibleShapes);
+    } else {
+      batch.setVisible(visibleShapes);
+    }
+  }
+
+  if (sdf) {
+    sdfCuller.query(view, visibleShapes);
+    sdfBatch.setVisible(visibleShapes);
+  }
+  cullingDirty = false;
+}
+
+void captureFrame() {
+  if (!capturePattern ||
+      (captureFrames > 0 && frameCapture.capturedFrames() >= captureFrames)) {
+    return;
+  }
+  glm::vec2 viewport = camera.getViewportSize();
+  frameCapture.capture(viewport.x, viewport.y);
+}
+
+// Swaps in shaders rebuilt by the reloader. Only the FXAA pass keeps its own
+// copy of a program handle; everything else reads the globals each frame.
+void reloadShaders() {
+  if (watchShaders && shaderReloader.applyReloads() > 0) {
+    frameTarget.setFxaaProgram(fxaaProgram);
+  }
+}
+
+void finishCapture() {
+  if (!capturePattern) {
+    return;
+  }
+  frameCapture.finish();
+  std::cout << "Captured " << frameCapture.capturedFrames() << " frames to "
+            << capturePattern;
+  if (frameCapture.droppedFrames() > 0) {
+    std::cout << " (" << frameCapture.droppedFrames()
+              << " dropped while the encoder caught up)";
+  }
+  std::cout << std::endl;
+}
+
+// The reload thread holds a shared context and the capture ring holds
+// mapped buffers, so both are stopped before GLFW goes away.
+void shutdown() {
+  stopStreaming();
+  finishCapture();
+  shaderReloader.stop();
+  glfwTerminate();
+}
+
 void display(void) {
 
+  updateCamera();
+  streamShapes();
+  cullShapes();
+
+  frameTarget.begin();
   glClear(GL_COLOR_BUFFER_BIT);
 
-  glUseProgram(program);
+  if (procedural) {
+    glUseProgram(proceduralProgram);
+    proceduralBatch.draw();
+  } else {
+    glUseProgram(program);
+    batch.draw();
+  }
 
-  glBindVertexArray(vao[0]);
-  glDrawArrays(GL_TRIANGLES, 0, TRIANGLE_NUM_POINTS);
+  if (sdf) {
+    glUseProgram(sdfProgram);
+    sdfBatch.draw(camera.getPixelSize());
+  }
 
-  glBindVertexArray(vao[1]);
-  for (int i = 0; i < SQUARE_NUM; ++i) {
-    glDrawArrays(GL_TRIANGLE_FAN, (i * 4), 4);
+  glUseProgram(lineProgram);
+  lineBatch.draw(camera.getViewportSize());
+
+  frameTarget.resolve();
+  captureFrame();
+  glFlush();
+}
+
+glm::vec2 getScreenPosition(GLFWwindow *window, double x, double y) {
+  int width, height;
+  glfwGetWindowSize(window, &width, &height);
+  return glm::vec2(x / width, y / height);
+}
+
+void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
+  double x, y;
+  glfwGetCursorPos(window, &x, &y);
+  camera.zoomAt(pow(1.1, yoffset), getScreenPosition(window, x, y));
+  cameraDirty = true;
+}
+
+void mouse_button_callback(GLFWwindow *window, int button, int action,
+                           int mods) {
+  if (button != GLFW_MOUSE_BUTTON_LEFT) {
+    return;
+  }
+  dragging = (action == GLFW_PRESS);
+  if (dragging) {
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    lastCursor = getScreenPosition(window, x, y);
   }
+}
 
-  glBindVertexArray(vao[2]);
-  glDrawArrays(GL_LINES, 0, LINE_NUM_POINTS);
+void cursor_position_callback(GLFWwindow *window, double x, double y) {
+  if (!dragging) {
+    return;
+  }
+  glm::vec2 cursor = getScreenPosition(window, x, y);
+  camera.pan(cursor - lastCursor);
+  lastCursor = cursor;
+  cameraDirty = true;
+}
 
-  glBindVertexArray(vao[3]);
+void runBenchmark(GLFWwindow *window, double setupTime) {
+  glfwSwapInterval(0);
 
-  glDrawArrays(GL_TRIANGLE_FAN, 0, CIRCLE_NUM_POINTS);
+  double start = glfwGetTime();
+  while (streamingChunks > 0) {
+    display();
+    glfwSwapBuffers(window);
+  }
+  glFinish();
+  double streamTime = glfwGetTime() - start;
+
+  start = glfwGetTime();
+  for (int i = 0; i < benchFrames; ++i) {
+    reloadShaders();
+    if (animate) {
+      updateShapes(glfwGetTime());
+    }
+    display();
+    glFinish();
+    glfwSwapBuffers(window);
+  }
+  double frameTime = (glfwGetTime() - start) / benchFrames;
+
+  std::cout << "Benchmark (" << (procedural ? "procedural" : "tessellated")
+            << (sdf ? " + sdf ellipses" : "") << ", " << stressShapes
+            << " extra shapes at scale " << stressScale << ")" << std::endl;
+  std::cout << "  setup: " << setupTime * 1000.0 << " ms" << std::endl;
+  std::cout << "  streamed: " << streamTime * 1000.0 << " ms" << std::endl;
+  std::cout << "  visible: "
+            << (procedural ? proceduralBatch.visibleCount()
+                           : batch.visibleCount()) +
+                   sdfBatch.visibleCount()
+            << " of " << culler.size() + sdfCuller.size() << " draws"
+            << std::endl;
+  std::cout << "  lines: " << lineBatch.segmentCount() << " segments at "
+            << lineWidth << " px in one draw" << std::endl;
+  std::cout << "  frame: " << frameTime * 1000.0 << " ms over " << benchFrames
+            << " frames" << std::endl;
+}
 
-  glBindVertexArray(vao[4]);
-  glDrawArrays(GL_TRIANGLE_FAN, 0, ELLIPSE_NUM_POINTS);
+// Accepts off, fxaa and msaa2, msaa4 or msaa8.
+bool parseAntialiasMode(const char *name, AntialiasMode &mode, int &samples) {
+  samples = 0;
+  if (strcmp(name, "off") == 0) {
+    mode = AA_OFF;
+  } else if (strcmp(name, "fxaa") == 0) {
+    mode = AA_FXAA;
+  } else if (strncmp(name, "msaa", 4) == 0 && atoi(name + 4) > 1) {
+    mode = AA_MSAA;
+    samples = atoi(name + 4);
+  } else {
+    std::cerr << "Unknown anti-aliasing mode " << name << std::endl;
+    return false;
+  }
+  return true;
+}
 
-  glFlush();
+// Times the current scene under each anti-aliasing mode.
+void runAntialiasBenchmark(GLFWwindow *window) {
+  const char *modes[] = {"off", "msaa2", "msaa4", "msaa8", "fxaa"};
+  glfwSwapInterval(0);
+
+  while (streamingChunks > 0) {
+    display();
+    glfwSwapBuffers(window);
+  }
+
+  glm::vec2 viewport = camera.getViewportSize();
+  std::cout << "Anti-aliasing benchmark (" << viewport.x << "x" << viewport.y
+            << ", " << antialiasBenchFrames << " frames)" << std::endl;
+  for (const char *name : modes) {
+    AntialiasMode mode;
+    int samples;
+    parseAntialiasMode(name, mode, samples);
+    frameTarget.release();
+    initFrameTarget(mode, samples);
+    if (frameTarget.getMode() != mode) {
+      std::cout << "  " << name << ": unsupported" << std::endl;
+      continue;
+    }
+
+    // One untimed frame so allocation is not counted.
+    display();
+    glFinish();
+    double start = glfwGetTime();
+    for (int i = 0; i < antialiasBenchFrames; ++i) {
+      reloadShaders();
+      if (animate) {
+        updateShapes(glfwGetTime());
+      }
+      display();
+      glfwSwapBuffers(window);
+    }
+    glFinish();
+    double frameTime = (glfwGetTime() - start) / antialiasBenchFrames;
+
+    std::cout << "  " << name;
+    if (mode == AA_MSAA && frameTarget.getSamples() != samples) {
+      std::cout << " (clamped to " << frameTarget.getSamples() << "x)";
+    }
+    std::cout << ": " << frameTime * 1000.0 << " ms" << std::endl;
+  }
 }
 
 int main(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--animate") == 0) {
+      animate = true;
+    } else if (strcmp(argv[i], "--procedural") == 0) {
+      procedural = true;
+    } else if (strcmp(argv[i], "--sdf") == 0) {
+      sdf = true;
+    } else if (strcmp(argv[i], "--shapes") == 0 && i + 1 < argc) {
+      stressShapes = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--shape-scale") == 0 && i + 1 < argc) {
+      stressScale = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--lines") == 0 && i + 1 < argc) {
+      stressLines = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--line-width") == 0 && i + 1 < argc) {
+      lineWidth = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+      benchFrames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--aa") == 0 && i + 1 < argc) {
+      if (!parseAntialiasMode(argv[++i], antialiasMode, antialiasSamples)) {
+        return -1;
+      }
+    } else if (strcmp(argv[i], "--bench-aa") == 0 && i + 1 < argc) {
+      antialiasBenchFrames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      capturePattern = argv[++i];
+    } else if (strcmp(argv[i], "--capture-frames") == 0 && i + 1 < argc) {
+      captureFrames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--watch-shaders") == 0) {
+      watchShaders = true;
+    } else if (strcmp(argv[i], "--import") == 0 && i + 1 < argc) {
+      svgFile = argv[++i];
+    } else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+      sceneFile = argv[++i];
+    } else if (strcmp(argv[i], "--export-scene") == 0 && i + 1 < argc) {
+      exportSceneFile = argv[++i];
+    } else if (strcmp(argv[i], "--sync") == 0) {
+      syncGeometry = true;
+    }
+  }
+
   glfwInit();
 
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
@@ -338,13 +1116,33 @@ int main(int argc, char **argv) {
   glfwMakeContextCurrent(window);
 
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+  glfwSetScrollCallback(window, scroll_callback);
+  glfwSetMouseButtonCallback(window, mouse_button_callback);
+  glfwSetCursorPosCallback(window, cursor_position_callback);
+
+  int framebufferWidth, framebufferHeight;
+  glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+  camera.setViewport(framebufferWidth, framebufferHeight);
 
   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
 
+  if (capturePattern && !frameCapture.start(capturePattern)) {
+    glfwTerminate();
+    return -1;
+  }
+  double setupStart = glfwGetTime();
   init();
+  glFinish();
+  double setupTime = glfwGetTime() - setupStart;
+
+  // Started after init(), whose failures exit, so every path past here
+  // reaches shutdown().
+  if (watchShaders && !shaderReloader.start(window, "shaders")) {
+    watchShaders = false;
+  }
 
   std::cout << "OpenGL Vendor: " << glGetString(GL_VENDOR) << std::endl;
   std::cout << "OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
@@ -352,10 +1150,27 @@ int main(int argc, char **argv) {
   std::cout << "Supported GLSL version is: "
             << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
 
+  if (antialiasBenchFrames > 0) {
+    runAntialiasBenchmark(window);
+    shutdown();
+    return 0;
+  }
+
+  if (benchFrames > 0) {
+    runBenchmark(window, setupTime);
+    shutdown();
+    return 0;
+  }
+
   while (!glfwWindowShouldClose(window)) {
+    reloadShaders();
+    if (animate) {
+      updateShapes(glfwGetTime());
+    }
     display();
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
+  shutdown();
   return 0;
 }
@@ -0,0 +1,729 @@
+#include "triangulate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Polygons above this many points index their nodes along a z-order curve so
+// ear tests only visit nearby points.
+const int HASHED_EAR_MIN_POINTS = 80;
+const int VERTEX_CACHE_SIZE = 32;
+
+// Node of the circular doubly linked list that ear clipping removes from.
+// prevZ and nextZ link the same nodes in z-order for hashed ear tests.
+struct EarNode {
+  int vertex;
+  double x, y;
+  int prev, next;
+  int prevZ, nextZ;
+  unsigned int z;
+  bool steiner;
+};
+
+// Ear clipping with hole bridging, after Eberly's "Triangulation by Ear
+// Clipping" and the earcut library. All nodes live in one array and link by
+// index; -1 is the null link.
+class EarClipper {
+public:
+  EarClipper(const aligned_vector<glm::vec2> &vertices,
+             std::vector<unsigned int> &indices)
+      : vertices(vertices), indices(indices) {}
+
+  void triangulate(const std::vector<PolygonRing> &rings);
+
+private:
+  int linkRing(int first, int count, bool clockwise);
+  int insertNode(int vertex, int last);
+  void removeNode(int node);
+  int filterPoints(int start, int end = -1);
+
+  void clipEars(int ear, int pass);
+  bool isEar(int ear) const;
+  bool isEarHashed(int ear) const;
+  int cureLocalIntersections(int start);
+  void splitEarcut(int start);
+  void addTriangle(int a, int b, int c);
+
+  int eliminateHoles(const std::vector<PolygonRing> &rings, int outerNode);
+  int findHoleBridge(int hole, int outerNode) const;
+  int splitPolygon(int a, int b);
+
+  void indexCurve(int start);
+  unsigned int getZOrder(double x, double y) const;
+
+  double getArea(int p, int q, int r) const;
+  bool equals(int a, int b) const;
+  bool intersects(int p1, int q1, int p2, int q2) const;
+  bool intersectsPolygon(int a, int b) const;
+  bool isLocallyInside(int a, int b) const;
+  bool isMiddleInside(int a, int b) const;
+  bool isValidDiagonal(int a, int b) const;
+  bool sectorContainsSector(int m, int p) const;
+
+  const aligned_vector<glm::vec2> &vertices;
+  std::vector<unsigned int> &indices;
+  std::vector<EarNode> nodes;
+
+  bool hashed = false;
+  double minX = 0.0, minY = 0.0, invSize = 0.0;
+};
+
+bool isPointInTriangle(double ax, double ay, double bx, double by, double cx,
+                       double cy, double px, double py) {
+  return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+         (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+         (bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
+
+int getSign(double value) { return (value > 0.0) - (value < 0.0); }
+
+void EarClipper::triangulate(const std::vector<PolygonRing> &rings) {
+  int outerNode = linkRing(0, rings[0].pointCount, true);
+  if (outerNode < 0 || nodes[outerNode].next == nodes[outerNode].prev) {
+    return;
+  }
+
+  if (rings.size() > 1) {
+    outerNode = eliminateHoles(rings, outerNode);
+  }
+
+  if ((int)vertices.size() > HASHED_EAR_MIN_POINTS) {
+    double maxX, maxY;
+    minX = maxX = vertices[0].x;
+    minY = maxY = vertices[0].y;
+    for (int i = 1; i < rings[0].pointCount; ++i) {
+      minX = std::min<double>(minX, vertices[i].x);
+      minY = std::min<double>(minY, vertices[i].y);
+      maxX = std::max<double>(maxX, vertices[i].x);
+      maxY = std::max<double>(maxY, vertices[i].y);
+    }
+    invSize = std::max(maxX - minX, maxY - minY);
+    invSize = invSize != 0.0 ? 32767.0 / invSize : 0.0;
+    hashed = invSize != 0.0;
+  }
+
+  clipEars(outerNode, 0);
+}
+
+// Links vertices [first, first + count) into a ring with the requested
+// winding and returns its last node. Rings are clockwise in y-down terms, i.e.
+// counter-clockwise with y up; holes use the opposite winding.
+int EarClipper::linkRing(int first, int count, bool clockwise) {
+  double area = 0.0;
+  for (int i = first, j = first + count - 1; i < first + count; j = i++) {
+    area += ((double)vertices[j].x - vertices[i].x) *
+            ((double)vertices[i].y + vertices[j].y);
+  }
+
+  int last = -1;
+  if (clockwise == (area > 0.0)) {
+    for (int i = first; i < first + count; ++i) {
+      last = insertNode(i, last);
+    }
+  } else {
+    for (int i = first + count - 1; i >= first; --i) {
+      last = insertNode(i, last);
+    }
+  }
+
+  if (last >= 0 && equals(last, nodes[last].next)) {
+    int next = nodes[last].next;
+    removeNode(last);
+    last = next;
+  }
+  return last;
+}
+
+int EarClipper::insertNode(int vertex, int last) {
+  EarNode node;
+  node.vertex = vertex;
+  node.x = vertices[vertex].x;
+  node.y = vertices[vertex].y;
+  node.prevZ = node.nextZ = -1;
+  node.z = 0;
+  node.steiner = false;
+
+  int index = nodes.size();
+  if (last < 0) {
+    node.prev = node.next = index;
+  } else {
+    node.next = nodes[last].next;
+    node.prev = last;
+    nodes[nodes[last].next].prev = index;
+    nodes[last].next = index;
+  }
+  nodes.push_back(node);
+  return index;
+}
+
+void EarClipper::removeNode(int node) {
+  EarNode &p = nodes[node];
+  nodes[p.next].prev = p.prev;
+  nodes[p.prev].next = p.next;
+  if (p.prevZ >= 0) {
+    nodes[p.prevZ].nextZ = p.nextZ;
+  }
+  if (p.nextZ >= 0) {
+    nodes[p.nextZ].prevZ = p.prevZ;
+  }
+}
+
+// Drops duplicate and collinear points between start and end.
+int EarClipper::filterPoints(int start, int end) {
+  if (start < 0) {
+    return start;
+  }
+  if (end < 0) {
+    end = start;
+  }
+
+  int p = start;
+  bool again;
+  do {
+    again = false;
+    const EarNode &node = nodes[p];
+    if (!node.steiner &&
+        (equals(p, node.next) || getArea(node.prev, p, node.next) == 0.0)) {
+      int prev = node.prev;
+      removeNode(p);
+      p = end = prev;
+      if (p == nodes[p].next) {
+        break;
+      }
+      again = true;
+    } else {
+      p = node.next;
+    }
+  } while (again || p != end);
+  return end;
+}
+
+void EarClipper::addTriangle(int a, int b, int c) {
+  indices.push_back(nodes[a].vertex);
+  indices.push_back(nodes[b].vertex);
+  indices.push_back(nodes[c].vertex);
+}
+
+// Clips ears until the ring is a triangle. When a full pass finds no ear the
+// ring is cleaned up (pass 1), local self-intersections are cut off (pass 2)
+// and finally the ring is split along a valid diagonal.
+void EarClipper::clipEars(int ear, int pass) {
+  if (ear < 0) {
+    return;
+  }
+  if (pass == 0 && hashed) {
+    indexCurve(ear);
+  }
+
+  int stop = ear;
+  while (nodes[ear].prev != nodes[ear].next) {
+    int prev = nodes[ear].prev;
+    int next = nodes[ear].next;
+
+    if (hashed ? isEarHashed(ear) : isEar(ear)) {
+      addTriangle(prev, ear, next);
+      removeNode(ear);
+      ear = stop = nodes[next].next;
+      continue;
+    }
+
+    ear = next;
+    if (ear == stop) {
+      if (pass == 0) {
+        clipEars(filterPoints(ear), 1);
+      } else if (pass == 1) {
+        ear = cureLocalIntersections(filterPoints(ear));
+        clipEars(ear, 2);
+      } else {
+        splitEarcut(ear);
+      }
+      break;
+    }
+  }
+}
+
+bool EarClipper::isEar(int ear) const {
+  int a = nodes[ear].prev, b = ear, c = nodes[ear].next;
+  if (getArea(a, b, c) >= 0.0) {
+    return false;
+  }
+
+  double ax = nodes[a].x, bx = nodes[b].x, cx = nodes[c].x;
+  double ay = nodes[a].y, by = nodes[b].y, cy = nodes[c].y;
+  double x0 = std::min({ax, bx, cx}), y0 = std::min({ay, by, cy});
+  double x1 = std::max({ax, bx, cx}), y1 = std::max({ay, by, cy});
+
+  // Only a reflex point inside the candidate triangle can block it.
+  for (int p = nodes[c].next; p != a; p = nodes[p].next) {
+    const EarNode &node = nodes[p];
+    if (node.x >= x0 && node.x <= x1 && node.y >= y0 && node.y <= y1 &&
+        isPointInTriangle(ax, ay, bx, by, cx, cy, node.x, node.y) &&
+        getArea(node.prev, p, node.next) >= 0.0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EarClipper::isEarHashed(int ear) const {
+  int a = nodes[ear].prev, b = ear, c = nodes[ear].next;
+  if (getArea(a, b, c) >= 0.0) {
+    return false;
+  }
+
+  double ax = nodes[a].x, bx = nodes[b].x, cx = nodes[c].x;
+  double ay = nodes[a].y, by = nodes[b].y, cy = nodes[c].y;
+  double x0 = std::min({ax, bx, cx}), y0 = std::min({ay, by, cy});
+  double x1 = std::max({ax, bx, cx}), y1 = std::max({ay, by, cy});
+
+  // Points inside the triangle's bounding box lie within this z-order range.
+  unsigned int minZ = getZOrder(x0, y0), maxZ = getZOrder(x1, y1);
+
+  auto blocks = [&](int p) {
+    const EarNode &node = nodes[p];
+    return node.x >= x0 && node.x <= x1 && node.y >= y0 && node.y <= y1 &&
+           p != a && p != c &&
+           isPointInTriangle(ax, ay, bx, by, cx, cy, node.x, node.y) &&
+           getArea(node.prev, p, node.next) >= 0.0;
+  };
+
+  int p = nodes[ear].prevZ, n = nodes[ear].nextZ;
+  while (p >= 0 && nodes[p].z >= minZ && n >= 0 && nodes[n].z <= maxZ) {
+    if (blocks(p) || blocks(n)) {
+      return false;
+    }
+    p = nodes[p].prevZ;
+    n = nodes[n].nextZ;
+  }
+  for (; p >= 0 && nodes[p].z >= minZ; p = nodes[p].prevZ) {
+    if (blocks(p)) {
+      return false;
+    }
+  }
+  for (; n >= 0 && nodes[n].z <= maxZ; n = nodes[n].nextZ) {
+    if (blocks(n)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int EarClipper::cureLocalIntersections(int start) {
+  int p = start;
+  do {
+    int a = nodes[p].prev, b = nodes[nodes[p].next].next;
+    if (!equals(a, b) && intersects(a, p, nodes[p].next, b) &&
+        isLocallyInside(a, b) && isLocallyInside(b, a)) {
+      addTriangle(a, p, b);
+      removeNode(nodes[p].next);
+      removeNode(p);
+      p = start = b;
+    }
+    p = nodes[p].next;
+  } while (p != start);
+  return filterPoints(p);
+}
+
+void EarClipper::splitEarcut(int start) {
+  int a = start;
+  do {
+    for (int b = nodes[nodes[a].next].next; b != nodes[a].prev;
+         b = nodes[b].next) {
+      if (nodes[a].vertex != nodes[b].vertex && isValidDiagonal(a, b)) {
+        int c = splitPolygon(a, b);
+        a = filterPoints(a, nodes[a].next);
+        c = filterPoints(c, nodes[c].next);
+        clipEars(a, 0);
+        clipEars(c, 0);
+        return;
+      }
+    }
+    a = nodes[a].next;
+  } while (a != start);
+}
+
+// Joins each hole to the outer ring, left to right, through a bridge to a
+// mutually visible outer point.
+int EarClipper::eliminateHoles(const std::vector<PolygonRing> &rings,
+                               int outerNode) {
+  std::vector<int> queue;
+  int first = rings[0].pointCount;
+  for (size_t i = 1; i < rings.size(); ++i) {
+    int list = linkRing(first, rings[i].pointCount, false);
+    first += rings[i].pointCount;
+    if (list < 0) {
+      continue;
+    }
+    if (list == nodes[list].next) {
+      nodes[list].steiner = true;
+    }
+
+    int leftmost = list;
+    int p = list;
+    do {
+      if (nodes[p].x < nodes[leftmost].x ||
+          (nodes[p].x == nodes[leftmost].x && nodes[p].y < nodes[leftmost].y)) {
+        leftmost = p;
+      }
+      p = nodes[p].next;
+    } while (p != list);
+    queue.push_back(leftmost);
+  }
+
+  std::sort(queue.begin(), queue.end(),
+            [this](int a, int b) { return nodes[a].x < nodes[b].x; });
+  for (int hole : queue) {
+    int bridge = findHoleBridge(hole, outerNode);
+    if (bridge < 0) {
+      continue;
+    }
+    int bridgeReverse = splitPolygon(bridge, hole);
+    filterPoints(bridgeReverse, nodes[bridgeReverse].next);
+    outerNode = filterPoints(bridge, nodes[bridge].next);
+  }
+  return outerNode;
+}
+
+int EarClipper::findHoleBridge(int hole, int outerNode) const {
+  double hx = nodes[hole].x, hy = nodes[hole].y;
+  double qx = -std::numeric_limits<double>::infinity();
+  int m = -1;
+
+  // Cast a ray left from the hole point and find the closest outer edge.
+  int p = outerNode;
+  do {
+    const EarNode &a = nodes[p];
+    const EarNode &b = nodes[a.next];
+    if (hy <= a.y && hy >= b.y && b.y != a.y) {
+      double x = a.x + (hy - a.y) * (b.x - a.x) / (b.y - a.y);
+      if (x <= hx && x > qx) {
+        qx = x;
+        m = a.x < b.x ? p : a.next;
+        if (x == hx) {
+          return m;
+        }
+      }
+    }
+    p = a.next;
+  } while (p != outerNode);
+
+  if (m < 0) {
+    return -1;
+  }
+
+  // A reflex point inside the triangle between the hole point, the hit and
+  // the edge's endpoint would block the bridge; take the one closest in
+  // angle to the ray instead.
+  int stop = m;
+  double mx = nodes[m].x, my = nodes[m].y;
+  double tanMin = std::numeric_limits<double>::infinity();
+  p = m;
+  do {
+    const EarNode &node = nodes[p];
+    if (hx >= node.x && node.x >= mx && hx != node.x &&
+        isPointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy,
+                          node.x, node.y)) {
+      double tan = std::abs(hy - node.y) / (hx - node.x);
+      if (isLocallyInside(p, hole) &&
+          (tan < tanMin ||
+           (tan == tanMin &&
+            (node.x > nodes[m].x ||
+             (node.x == nodes[m].x && sectorContainsSector(m, p)))))) {
+        m = p;
+        tanMin = tan;
+      }
+    }
+    p = node.next;
+  } while (p != stop);
+  return m;
+}
+
+// Connects a and b with a diagonal, splitting the ring in two. Both ends are
+// duplicated so each ring stays a closed list; returns b's copy.
+int EarClipper::splitPolygon(int a, int b) {
+  int a2 = nodes.size();
+  int b2 = a2 + 1;
+  nodes.push_back(nodes[a]);
+  nodes.push_back(nodes[b]);
+  nodes[a2].prevZ = nodes[a2].nextZ = nodes[b2].prevZ = nodes[b2].nextZ = -1;
+  nodes[a2].z = nodes[b2].z = 0;
+
+  int an = nodes[a].next, bp = nodes[b].prev;
+  nodes[a].next = b;
+  nodes[b].prev = a;
+  nodes[a2].next = an;
+  nodes[an].prev = a2;
+  nodes[b2].next = a2;
+  nodes[a2].prev = b2;
+  nodes[bp].next = b2;
+  nodes[b2].prev = bp;
+  return b2;
+}
+
+void EarClipper::indexCurve(int start) {
+  std::vector<int> order;
+  int p = start;
+  do {
+    if (nodes[p].z == 0) {
+      nodes[p].z = getZOrder(nodes[p].x, nodes[p].y);
+    }
+    order.push_back(p);
+    p = nodes[p].next;
+  } while (p != start);
+
+  std::stable_sort(order.begin(), order.end(),
+                   [this](int a, int b) { return nodes[a].z < nodes[b].z; });
+  for (size_t i = 0; i < order.size(); ++i) {
+    nodes[order[i]].prevZ = i > 0 ? order[i - 1] : -1;
+    nodes[order[i]].nextZ = i + 1 < order.size() ? order[i + 1] : -1;
+  }
+}
+
+// Interleaves the bits of 15-bit grid coordinates.
+unsigned int EarClipper::getZOrder(double x, double y) const {
+  unsigned int ix = (unsigned int)((x - minX) * invSize);
+  unsigned int iy = (unsigned int)((y - minY) * invSize);
+
+  ix = (ix | (ix << 8)) & 0x00FF00FF;
+  ix = (ix | (ix << 4)) & 0x0F0F0F0F;
+  ix = (ix | (ix << 2)) & 0x33333333;
+  ix = (ix | (ix << 1)) & 0x55555555;
+
+  iy = (iy | (iy << 8)) & 0x00FF00FF;
+  iy = (iy | (iy << 4)) & 0x0F0F0F0F;
+  iy = (iy | (iy << 2)) & 0x33333333;
+  iy = (iy | (iy << 1)) & 0x55555555;
+
+  return ix | (iy << 1);
+}
+
+// Negative when p, q, r turn counter-clockwise (y up).
+double EarClipper::getArea(int p, int q, int r) const {
+  const EarNode &a = nodes[p], &b = nodes[q], &c = nodes[r];
+  return (b.y - a.y) * (c.x - b.x) - (b.x - a.x) * (c.y - b.y);
+}
+
+bool EarClipper::equals(int a, int b) const {
+  return nodes[a].x == nodes[b].x && nodes[a].y == nodes[b].y;
+}
+
+bool isOnSegment(const EarNode &p, const EarNode &q, const EarNode &r) {
+  return q.x <= std::max(p.x, r.x) && q.x >= std::min(p.x, r.x) &&
+         q.y <= std::max(p.y, r.y) && q.y >= std::min(p.y, r.y);
+}
+
+bool EarClipper::intersects(int p1, int q1, int p2, int q2) const {
+  int o1 = getSign(getArea(p1, q1, p2));
+  int o2 = getSign(getArea(p1, q1, q2));
+  int o3 = getSign(getArea(p2, q2, p1));
+  int o4 = getSign(getArea(p2, q2, q1));
+
+  if (o1 != o2 && o3 != o4) {
+    return true;
+  }
+  // Collinear cases.
+  return (o1 == 0 && isOnSegment(nodes[p1], nodes[p2], nodes[q1])) ||
+         (o2 == 0 && isOnSegment(nodes[p1], nodes[q2], nodes[q1])) ||
+         (o3 == 0 && isOnSegment(nodes[p2], nodes[p1], nodes[q2])) ||
+         (o4 == 0 && isOnSegment(nodes[p2], nodes[q1], nodes[q2]));
+}
+
+bool EarClipper::intersectsPolygon(int a, int b) const {
+  int p = a;
+  do {
+    int next = nodes[p].next;
+    if (nodes[p].vertex != nodes[a].vertex &&
+        nodes[next].vertex != nodes[a].vertex &&
+        nodes[p].vertex != nodes[b].vertex &&
+        nodes[next].vertex != nodes[b].vertex && intersects(p, next, a, b)) {
+      return true;
+    }
+    p = next;
+  } while (p != a);
+  return false;
+}
+
+bool EarClipper::isLocallyInside(int a, int b) const {
+  int prev = nodes[a].prev, next = nodes[a].next;
+  if (getArea(prev, a, next) < 0.0) {
+    return getArea(a, b, next) >= 0.0 && getArea(a, prev, b) >= 0.0;
+  }
+  return getArea(a, b, prev) < 0.0 || getArea(a, next, b) < 0.0;
+}
+
+bool EarClipper::isMiddleInside(int a, int b) const {
+  double px = (nodes[a].x + nodes[b].x) / 2;
+  double py = (nodes[a].y + nodes[b].y) / 2;
+  bool inside = false;
+
+  int p = a;
+  do {
+    const EarNode &node = nodes[p];
+    const EarNode &next = nodes[node.next];
+    if ((node.y > py) != (next.y > py) && next.y != node.y &&
+        px < (next.x - node.x) * (py - node.y) / (next.y - node.y) + node.x) {
+      inside = !inside;
+    }
+    p = node.next;
+  } while (p != a);
+  return inside;
+}
+
+bool EarClipper::isValidDiagonal(int a, int b) const {
+  const EarNode &na = nodes[a], &nb = nodes[b];
+  if (nodes[na.next].vertex == nb.vertex ||
+      nodes[na.prev].vertex == nb.vertex || intersectsPolygon(a, b)) {
+    return false;
+  }
+  if (isLocallyInside(a, b) && isLocallyInside(b, a) && isMiddleInside(a, b) &&
+      (getArea(na.prev, a, nb.prev) != 0.0 || getArea(a, nb.prev, b) != 0.0)) {
+    return true;
+  }
+  // Zero-length diagonal between two convex corners.
+  return equals(a, b) && getArea(na.prev, a, na.next) > 0.0 &&
+         getArea(nb.prev, b, nb.next) > 0.0;
+}
+
+bool EarClipper::sectorContainsSector(int m, int p) const {
+  return getArea(nodes[m].prev, m, nodes[p].prev) < 0.0 &&
+         getArea(nodes[p].next, m, nodes[m].next) < 0.0;
+}
+
+bool triangulatePolygon(const std::vector<PolygonRing> &rings,
+                        aligned_vector<glm::vec2> &vertices,
+                        std::vector<unsigned int> &indices) {
+  vertices.clear();
+  indices.clear();
+  if (rings.empty() || rings[0].pointCount < 3) {
+    return false;
+  }
+
+  for (const PolygonRing &ring : rings) {
+    vertices.insert(vertices.end(), ring.points,
+                    ring.points + ring.pointCount);
+  }
+
+  EarClipper clipper(vertices, indices);
+  clipper.triangulate(rings);
+  return !indices.empty();
+}
+
+// Favors vertices that were used recently (but not by the last triangle,
+// which the cache already holds) and vertices with few triangles left, so
+// that isolated triangles are not left behind.
+float getVertexScore(int cachePosition, int activeTriangles) {
+  if (activeTriangles == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cachePosition >= 3) {
+    float scale = 1.0f / (VERTEX_CACHE_SIZE - 3);
+    score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+  } else if (cachePosition >= 0) {
+    score = 0.75f;
+  }
+  return score + 2.0f / std::sqrt((float)activeTriangles);
+}
+
+void optimizeVertexCache(unsigned int indices[], size_t indexCount,
+                         size_t vertexCount) {
+  size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Per-vertex lists of triangles not yet emitted; the first activeTriangles
+  // entries of each range are live.
+  std::vector<int> activeTriangles(vertexCount, 0);
+  for (size_t i = 0; i < 3 * triangleCount; ++i) {
+    activeTriangles[indices[i]]++;
+  }
+  std::vector<int> firstTriangle(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    firstTriangle[v + 1] = firstTriangle[v] + activeTriangles[v];
+  }
+  std::vector<int> vertexTriangles(3 * triangleCount);
+  std::vector<int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+  for (size_t i = 0; i < 3 * triangleCount; ++i) {
+    vertexTriangles[fill[indices[i]]++] = i / 3;
+  }
+
+  std::vector<float> vertexScore(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    vertexScore[v] = getVertexScore(-1, activeTriangles[v]);
+  }
+  std::vector<float> triangleScore(triangleCount);
+  for (size_t t = 0; t < triangleCount; ++t) {
+    triangleScore[t] = vertexScore[indices[3 * t]] +
+                       vertexScore[indices[3 * t + 1]] +
+                       vertexScore[indices[3 * t + 2]];
+  }
+
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<unsigned int> output;
+  output.reserve(3 * triangleCount);
+  std::vector<int> cache, nextCache;
+  size_t scanCursor = 0;
+  int best = -1;
+
+  for (size_t count = 0; count < triangleCount; ++count) {
+    // Nothing in the cache touches a remaining triangle; start a new strip.
+    if (best < 0) {
+      while (emitted[scanCursor]) {
+        scanCursor++;
+      }
+      best = scanCursor;
+    }
+
+    emitted[best] = true;
+    const unsigned int *triangle = &indices[3 * best];
+    nextCache.assign(triangle, triangle + 3);
+    for (int i = 0; i < 3; ++i) {
+      unsigned int v = triangle[i];
+      output.push_back(v);
+
+      int *list = &vertexTriangles[firstTriangle[v]];
+      int *end = list + activeTriangles[v];
+      std::swap(*std::find(list, end, best), *(end - 1));
+      activeTriangles[v]--;
+    }
+
+    for (int v : cache) {
+      if (v != nextCache[0] && v != nextCache[1] && v != nextCache[2]) {
+        nextCache.push_back(v);
+      }
+    }
+    cache.swap(nextCache);
+
+    // Rescore everything whose cache position changed, including vertices
+    // that just fell out of the cache.
+    for (size_t i = 0; i < cache.size(); ++i) {
+      int v = cache[i];
+      int position = i < VERTEX_CACHE_SIZE ? i : -1;
+      float score = getVertexScore(position, activeTriangles[v]);
+      float delta = score - vertexScore[v];
+      vertexScore[v] = score;
+      for (int j = 0; j < activeTriangles[v]; ++j) {
+        triangleScore[vertexTriangles[firstTriangle[v] + j]] += delta;
+      }
+    }
+    if (cache.size() > VERTEX_CACHE_SIZE) {
+      cache.resize(VERTEX_CACHE_SIZE);
+    }
+
+    best = -1;
+    float bestScore = -1.0f;
+    for (int v : cache) {
+      for (int j = 0; j < activeTriangles[v]; ++j) {
+        int t = vertexTriangles[firstTriangle[v] + j];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          best = t;
+        }
+      }
+    }
+  }
+
+  std::copy(output.begin(), output.end(), indices);
+}
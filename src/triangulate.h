@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "aligned_vector.h"
+
+// One closed ring of a polygon; the last point connects back to the first.
+struct PolygonRing {
+  const glm::vec2 *points;
+  int pointCount;
+};
+
+// Triangulates a polygon with holes by ear clipping. rings[0] is the outer
+// boundary and any further rings are holes; either winding is accepted.
+// vertices receives the ring points in order and indices the triangles into
+// it, counter-clockwise. Holes are joined to the boundary through bridge
+// edges, so no vertices are added. Returns false if nothing was produced.
+bool triangulatePolygon(const std::vector<PolygonRing> &rings,
+                        aligned_vector<glm::vec2> &vertices,
+                        std::vector<unsigned int> &indices);
+
+// Reorders triangles for the post-transform vertex cache (Forsyth's
+// linear-speed algorithm). Triangle winding is preserved.
+void optimizeVertexCache(unsigned int indices[], size_t indexCount,
+                         size_t vertexCount);